@@ -0,0 +1,99 @@
+#ifndef BOUNDS_H
+#define BOUNDS_H
+
+#include <glm/glm.hpp>
+
+#include <cmath>
+
+struct AABB {
+	glm::vec3 min;
+	glm::vec3 max;
+
+	glm::vec3 Center() const { return (min + max) * 0.5f; }
+	glm::vec3 Extent() const { return (max - min) * 0.5f; }
+};
+
+struct BoundingSphere {
+	glm::vec3 center;
+	float radius;
+};
+
+// box around a transformed box (Arvo, "Transforming Axis-Aligned Bounding Boxes")
+inline AABB TransformAABB(const AABB &box, const glm::mat4 &transform)
+{
+	glm::vec3 center = glm::vec3(transform * glm::vec4(box.Center(), 1.0f));
+	glm::vec3 extent = box.Extent();
+	glm::vec3 newExtent(0.0f);
+	for (int row = 0; row < 3; row++)
+	{
+		for (int column = 0; column < 3; column++)
+			newExtent[row] += std::fabs(transform[column][row]) * extent[column];
+	}
+	AABB result;
+	result.min = center - newExtent;
+	result.max = center + newExtent;
+	return result;
+}
+
+inline BoundingSphere TransformSphere(const BoundingSphere &sphere, const glm::mat4 &transform)
+{
+	// the largest axis scale keeps the sphere conservative under non-uniform scaling
+	float scale = glm::max(glm::length(glm::vec3(transform[0])), glm::max(glm::length(glm::vec3(transform[1])), glm::length(glm::vec3(transform[2]))));
+	BoundingSphere result;
+	result.center = glm::vec3(transform * glm::vec4(sphere.center, 1.0f));
+	result.radius = sphere.radius * scale;
+	return result;
+}
+
+// View frustum as six inward-facing planes (xyz: normal, w: distance)
+struct Frustum {
+	glm::vec4 planes[6];
+
+	// extracts the planes from a projection * view matrix (Gribb & Hartmann)
+	static Frustum FromMatrix(const glm::mat4 &viewProjection)
+	{
+		glm::mat4 m = glm::transpose(viewProjection);
+		Frustum frustum;
+		frustum.planes[0] = m[3] + m[0]; // left
+		frustum.planes[1] = m[3] - m[0]; // right
+		frustum.planes[2] = m[3] + m[1]; // bottom
+		frustum.planes[3] = m[3] - m[1]; // top
+		frustum.planes[4] = m[3] + m[2]; // near
+		frustum.planes[5] = m[3] - m[2]; // far
+		for (int i = 0; i < 6; i++)
+			frustum.planes[i] /= glm::length(glm::vec3(frustum.planes[i]));
+		return frustum;
+	}
+
+	bool Intersects(const BoundingSphere &sphere) const
+	{
+		for (int i = 0; i < 6; i++)
+		{
+			if (glm::dot(glm::vec3(planes[i]), sphere.center) + planes[i].w < -sphere.radius)
+				return false;
+		}
+		return true;
+	}
+
+	bool Intersects(const AABB &box) const
+	{
+		for (int i = 0; i < 6; i++)
+		{
+			// the corner furthest along the plane normal
+			glm::vec3 normal(planes[i]);
+			glm::vec3 corner(normal.x >= 0.0f ? box.max.x : box.min.x,
+				normal.y >= 0.0f ? box.max.y : box.min.y,
+				normal.z >= 0.0f ? box.max.z : box.min.z);
+			if (glm::dot(normal, corner) + planes[i].w < 0.0f)
+				return false;
+		}
+		return true;
+	}
+};
+
+// per-frame culling counters
+struct CullingStats {
+	unsigned int drawn = 0;
+	unsigned int culled = 0;
+};
+#endif
@@ -0,0 +1,242 @@
+#include "ClusteredLights.h"
+#include "GLState.h"
+#include "RenderStats.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <iostream>
+
+const unsigned int CLUSTER_COUNT = CLUSTER_X * CLUSTER_Y * CLUSTER_Z;
+const unsigned int LIGHT_TEXELS = 6;
+const size_t MAX_LIGHTS = 65535; // 16-bit light indices
+
+float LightRadius(const SpotLight &light)
+{
+	float intensity = std::max(std::max(light.diffuse.x, light.diffuse.y), light.diffuse.z);
+	// solve constant + linear * d + quadratic * d^2 = intensity / LIGHT_CUTOFF
+	float c = light.constant - intensity / LIGHT_CUTOFF;
+	if (light.quadratic > 0.0f)
+		return (-light.linear + std::sqrt(std::max(light.linear * light.linear - 4.0f * light.quadratic * c, 0.0f))) / (2.0f * light.quadratic);
+	if (light.linear > 0.0f)
+		return std::max(-c / light.linear, 0.0f);
+	return FLT_MAX;
+}
+
+ClusteredLights::ClusteredLights()
+{
+	glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &maxTexels);
+	clusterNear = clusterFar = 0.0f;
+	maxClusterLights = 0;
+
+	GLBuffer *buffers[] = { &lightDataBuffer, &gridBuffer, &indexBuffer };
+	GLTexture *textures[] = { &lightDataTexture, &gridTexture, &indexTexture };
+	GLenum formats[] = { GL_RGBA32F, GL_RG32UI, GL_R16UI };
+	for (int i = 0; i < 3; i++)
+	{
+		*buffers[i] = GLBuffer::Create();
+		glBindBuffer(GL_TEXTURE_BUFFER, *buffers[i]);
+		glBufferData(GL_TEXTURE_BUFFER, 16, NULL, GL_STREAM_DRAW);
+		*textures[i] = GLTexture::Create();
+		GLState::BindTexture(GL_TEXTURE_BUFFER, *textures[i]);
+		glTexBuffer(GL_TEXTURE_BUFFER, formats[i], *buffers[i]);
+	}
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+	GLState::BindTexture(GL_TEXTURE_BUFFER, 0);
+}
+
+void ClusteredLights::SetSamplers(const Shader &shader) const
+{
+	shader.setInt("lightData", LIGHT_DATA_UNIT);
+	shader.setInt("clusterGrid", CLUSTER_GRID_UNIT);
+	shader.setInt("lightIndices", LIGHT_INDEX_UNIT);
+}
+
+float ClusteredLights::SliceScale() const
+{
+	return CLUSTER_Z / std::log(clusterFar / clusterNear);
+}
+
+float ClusteredLights::SliceBias() const
+{
+	return -CLUSTER_Z * std::log(clusterNear) / std::log(clusterFar / clusterNear);
+}
+
+void ClusteredLights::buildClusters(const glm::mat4 &projection, float zNear, float zFar)
+{
+	clusterProjection = projection;
+	clusterNear = zNear;
+	clusterFar = zFar;
+	clusterMin.resize(CLUSTER_COUNT);
+	clusterMax.resize(CLUSTER_COUNT);
+	clusterSpheres.resize(CLUSTER_COUNT);
+
+	// a symmetric perspective projection maps view x to x * P[0][0] / depth
+	for (unsigned int z = 0; z < CLUSTER_Z; z++)
+	{
+		float sliceNear = zNear * std::pow(zFar / zNear, (float)z / CLUSTER_Z);
+		float sliceFar = zNear * std::pow(zFar / zNear, (float)(z + 1) / CLUSTER_Z);
+		for (unsigned int y = 0; y < CLUSTER_Y; y++)
+		{
+			float y0 = (-1.0f + 2.0f * y / CLUSTER_Y) / projection[1][1];
+			float y1 = (-1.0f + 2.0f * (y + 1) / CLUSTER_Y) / projection[1][1];
+			for (unsigned int x = 0; x < CLUSTER_X; x++)
+			{
+				float x0 = (-1.0f + 2.0f * x / CLUSTER_X) / projection[0][0];
+				float x1 = (-1.0f + 2.0f * (x + 1) / CLUSTER_X) / projection[0][0];
+				unsigned int cluster = (z * CLUSTER_Y + y) * CLUSTER_X + x;
+				clusterMin[cluster] = glm::vec3(std::min(x0 * sliceNear, x0 * sliceFar), std::min(y0 * sliceNear, y0 * sliceFar), -sliceFar);
+				clusterMax[cluster] = glm::vec3(std::max(x1 * sliceNear, x1 * sliceFar), std::max(y1 * sliceNear, y1 * sliceFar), -sliceNear);
+				glm::vec3 center = (clusterMin[cluster] + clusterMax[cluster]) * 0.5f;
+				clusterSpheres[cluster] = glm::vec4(center, glm::length(clusterMax[cluster] - center));
+			}
+		}
+	}
+}
+
+void ClusteredLights::assignLight(const SpotLight &light, float range, unsigned int index, const glm::mat4 &view)
+{
+	glm::vec3 position = glm::vec3(view * glm::vec4(light.position, 1.0f));
+	glm::vec3 direction = glm::normalize(glm::mat3(view) * light.direction);
+
+	// 1. depth slices the light's sphere overlaps
+	float depthMin = -position.z - range;
+	float depthMax = -position.z + range;
+	if (depthMax < clusterNear || depthMin > clusterFar)
+		return;
+	depthMin = std::max(depthMin, clusterNear);
+	depthMax = std::min(depthMax, clusterFar);
+	float sliceScale = SliceScale(), sliceBias = SliceBias();
+	int z0 = glm::clamp((int)std::floor(std::log(depthMin) * sliceScale + sliceBias), 0, CLUSTER_Z - 1);
+	int z1 = glm::clamp((int)std::floor(std::log(depthMax) * sliceScale + sliceBias), 0, CLUSTER_Z - 1);
+
+	// 2. screen tiles: x / depth is extremal at the corners of the sphere's box
+	glm::vec2 ndcMin(FLT_MAX), ndcMax(-FLT_MAX);
+	float depths[] = { depthMin, depthMax };
+	for (int i = 0; i < 2; i++)
+	{
+		for (int sign = -1; sign <= 1; sign += 2)
+		{
+			glm::vec2 ndc = glm::vec2((position.x + sign * range) * clusterProjection[0][0],
+				(position.y + sign * range) * clusterProjection[1][1]) / depths[i];
+			ndcMin = glm::min(ndcMin, ndc);
+			ndcMax = glm::max(ndcMax, ndc);
+		}
+	}
+	if (ndcMax.x < -1.0f || ndcMin.x > 1.0f || ndcMax.y < -1.0f || ndcMin.y > 1.0f)
+		return;
+	int x0 = glm::clamp((int)std::floor((ndcMin.x * 0.5f + 0.5f) * CLUSTER_X), 0, CLUSTER_X - 1);
+	int x1 = glm::clamp((int)std::floor((ndcMax.x * 0.5f + 0.5f) * CLUSTER_X), 0, CLUSTER_X - 1);
+	int y0 = glm::clamp((int)std::floor((ndcMin.y * 0.5f + 0.5f) * CLUSTER_Y), 0, CLUSTER_Y - 1);
+	int y1 = glm::clamp((int)std::floor((ndcMax.y * 0.5f + 0.5f) * CLUSTER_Y), 0, CLUSTER_Y - 1);
+
+	// 3. exact tests per candidate cluster: sphere against the cluster box, then the cone against
+	//    the cluster's bounding sphere (Wronski, "Cull that cone!"); cones wider than a hemisphere
+	//    are treated as spheres
+	bool testCone = light.outerCutOff > -0.001f;
+	float coneCos = std::max(light.outerCutOff, 0.0f);
+	float coneSin = std::sqrt(1.0f - coneCos * coneCos);
+	for (int z = z0; z <= z1; z++)
+	{
+		for (int y = y0; y <= y1; y++)
+		{
+			for (int x = x0; x <= x1; x++)
+			{
+				unsigned int cluster = (z * CLUSTER_Y + y) * CLUSTER_X + x;
+				glm::vec3 closest = glm::clamp(position, clusterMin[cluster], clusterMax[cluster]);
+				glm::vec3 offset = closest - position;
+				if (glm::dot(offset, offset) > range * range)
+					continue;
+
+				if (testCone)
+				{
+					glm::vec3 center(clusterSpheres[cluster]);
+					float radius = clusterSpheres[cluster].w;
+					glm::vec3 v = center - position;
+					float alongAxis = glm::dot(v, direction);
+					float closestDistance = coneCos * std::sqrt(std::max(glm::dot(v, v) - alongAxis * alongAxis, 0.0f)) - alongAxis * coneSin;
+					if (closestDistance > radius || alongAxis < -radius)
+						continue;
+				}
+				assignments.push_back(glm::uvec2(cluster, index));
+			}
+		}
+	}
+}
+
+void ClusteredLights::upload(unsigned int buffer, const void *data, size_t size)
+{
+	glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+	// fresh storage every frame, so the driver doesn't wait for last frame's draws
+	glBufferData(GL_TEXTURE_BUFFER, size, data, GL_STREAM_DRAW);
+	RenderStats::CountBufferUpload(size);
+}
+
+void ClusteredLights::Update(const std::vector<SpotLight> &lights, const glm::mat4 &view, const glm::mat4 &projection, float zNear, float zFar)
+{
+	if (projection != clusterProjection || zNear != clusterNear || zFar != clusterFar)
+		buildClusters(projection, zNear, zFar);
+
+	size_t lightCount = lights.size();
+	if (lightCount > MAX_LIGHTS || lightCount * LIGHT_TEXELS > (size_t)maxTexels)
+	{
+		lightCount = std::min(MAX_LIGHTS, (size_t)maxTexels / LIGHT_TEXELS);
+		std::cout << "ERROR::CLUSTERED_LIGHTS::TOO_MANY_LIGHTS " << lights.size() << ", using " << lightCount << std::endl;
+	}
+
+	// light data, laid out for CalcClusterLights in the shaders; no light reaches past the far plane
+	lightTexels.resize(std::max(lightCount * LIGHT_TEXELS, (size_t)1));
+	for (size_t i = 0; i < lightCount; i++)
+	{
+		const SpotLight &light = lights[i];
+		float range = std::min(light.radius, zFar);
+		glm::vec4 *texels = &lightTexels[i * LIGHT_TEXELS];
+		texels[0] = glm::vec4(light.position, light.cutOff);
+		texels[1] = glm::vec4(light.direction, light.outerCutOff);
+		texels[2] = glm::vec4(light.ambient, light.constant);
+		texels[3] = glm::vec4(light.diffuse, light.linear);
+		texels[4] = glm::vec4(light.specular, light.quadratic);
+		texels[5] = glm::vec4(range, 0.0f, 0.0f, 0.0f);
+	}
+
+	// assign, then group the (cluster, light) pairs by cluster with a counting sort
+	assignments.clear();
+	for (size_t i = 0; i < lightCount; i++)
+		assignLight(lights[i], lightTexels[i * LIGHT_TEXELS + 5].x, (unsigned int)i, view);
+	if (assignments.size() > (size_t)maxTexels)
+	{
+		std::cout << "ERROR::CLUSTERED_LIGHTS::TOO_MANY_ASSIGNMENTS " << assignments.size() << std::endl;
+		assignments.resize(maxTexels);
+	}
+
+	grid.assign(CLUSTER_COUNT, glm::uvec2(0));
+	for (size_t i = 0; i < assignments.size(); i++)
+		grid[assignments[i].x].y++;
+	unsigned int offset = 0;
+	maxClusterLights = 0;
+	for (unsigned int i = 0; i < CLUSTER_COUNT; i++)
+	{
+		grid[i].x = offset;
+		offset += grid[i].y;
+		maxClusterLights = std::max(maxClusterLights, grid[i].y);
+		grid[i].y = 0;
+	}
+	indices.resize(std::max(assignments.size(), (size_t)1));
+	for (size_t i = 0; i < assignments.size(); i++)
+	{
+		glm::uvec2 &cell = grid[assignments[i].x];
+		indices[cell.x + cell.y++] = (uint16_t)assignments[i].y;
+	}
+
+	upload(lightDataBuffer, &lightTexels[0], lightTexels.size() * sizeof(glm::vec4));
+	upload(gridBuffer, &grid[0], grid.size() * sizeof(glm::uvec2));
+	upload(indexBuffer, &indices[0], indices.size() * sizeof(uint16_t));
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+void ClusteredLights::Bind() const
+{
+	GLState::BindTexture(LIGHT_DATA_UNIT, GL_TEXTURE_BUFFER, lightDataTexture);
+	GLState::BindTexture(CLUSTER_GRID_UNIT, GL_TEXTURE_BUFFER, gridTexture);
+	GLState::BindTexture(LIGHT_INDEX_UNIT, GL_TEXTURE_BUFFER, indexTexture);
+}
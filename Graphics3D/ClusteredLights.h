@@ -0,0 +1,96 @@
+#ifndef CLUSTERED_LIGHTS_H
+#define CLUSTERED_LIGHTS_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "Shader.h"
+#include "GLHandles.h"
+
+#include <cstdint>
+#include <vector>
+
+// froxel grid: screen tiles x depth slices; must match model.vertex/fragment.shader
+#define CLUSTER_X 16
+#define CLUSTER_Y 9
+#define CLUSTER_Z 24
+
+// texture units the cluster data is bound to, well above the ones materials use
+const unsigned int LIGHT_DATA_UNIT = 13;
+const unsigned int CLUSTER_GRID_UNIT = 14;
+const unsigned int LIGHT_INDEX_UNIT = 15;
+
+// attenuated diffuse below which a light no longer visibly adds to a surface (the 5/256 LearnOpenGL
+// derives its attenuation table from)
+const float LIGHT_CUTOFF = 5.0f / 256.0f;
+
+struct SpotLight {
+	glm::vec3 position;
+	glm::vec3 direction;
+	float cutOff;
+	float outerCutOff;
+
+	glm::vec3 ambient;
+	glm::vec3 diffuse;
+	glm::vec3 specular;
+
+	float constant;
+	float linear;
+	float quadratic;
+	// distance at which the light is cut off: the shaders fade it out towards it, and it bounds the
+	// clusters the light is assigned to; see LightRadius
+	float radius;
+};
+
+// distance at which the light's attenuated diffuse falls below LIGHT_CUTOFF; the specular term
+// only adds a highlight, so it does not count
+float LightRadius(const SpotLight &light);
+
+// Clustered forward lighting (Olsson et al., "Clustered Deferred and Forward Shading"): every
+// frame the spot lights are assigned to the cells of a view-frustum grid, sliced exponentially in
+// depth, and the shaders only evaluate the lights listed for the cell a fragment falls in.
+// Everything is uploaded as texture buffers, which GL 3.3 already has:
+//   lightData    RGBA32F, 6 texels per light
+//   clusterGrid  RG32UI, (first index, light count) per cluster
+//   lightIndices R16UI, the lights of all clusters back to back
+class ClusteredLights
+{
+	GLBuffer lightDataBuffer, gridBuffer, indexBuffer;
+	GLTexture lightDataTexture, gridTexture, indexTexture;
+	GLint maxTexels;
+
+	// view-space bounds of every cluster, rebuilt when the projection changes
+	glm::mat4 clusterProjection;
+	float clusterNear, clusterFar;
+	std::vector<glm::vec3> clusterMin, clusterMax;
+	std::vector<glm::vec4> clusterSpheres;
+
+	// scratch, kept between frames to avoid reallocations
+	std::vector<glm::vec4> lightTexels;
+	std::vector<glm::uvec2> grid;
+	std::vector<uint16_t> indices;
+	std::vector<glm::uvec2> assignments; // (cluster, light)
+
+	unsigned int maxClusterLights;
+
+	void buildClusters(const glm::mat4 &projection, float zNear, float zFar);
+	void assignLight(const SpotLight &light, float range, unsigned int index, const glm::mat4 &view);
+	static void upload(unsigned int buffer, const void *data, size_t size);
+
+public:
+	ClusteredLights();
+	// points the shader's samplers at the cluster texture units; the shader must be in use
+	void SetSamplers(const Shader &shader) const;
+	// rebuilds and uploads the per-cluster light lists for this frame's camera
+	void Update(const std::vector<SpotLight> &lights, const glm::mat4 &view, const glm::mat4 &projection, float zNear, float zFar);
+	// binds the cluster data to its texture units
+	void Bind() const;
+
+	// depth slice of a view-space distance d is log(d) * SliceScale() + SliceBias()
+	float SliceScale() const;
+	float SliceBias() const;
+
+	size_t IndexCount() const { return assignments.size(); }
+	unsigned int MaxClusterLights() const { return maxClusterLights; }
+};
+#endif
@@ -0,0 +1,120 @@
+#include "CpuProfiler.h"
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+static const Clock::time_point startTime = Clock::now();
+
+struct ThreadBuffer {
+	unsigned int id;
+	std::string name;
+	std::vector<ProfileEvent> events;
+};
+
+static std::mutex registryMutex;
+
+static std::vector<std::unique_ptr<ThreadBuffer>> &registry()
+{
+	// intentionally never destroyed: zones may still close during static destruction
+	static std::vector<std::unique_ptr<ThreadBuffer>> *buffers = new std::vector<std::unique_ptr<ThreadBuffer>>();
+	return *buffers;
+}
+
+// the calling thread's buffer; kept after the thread exits so its zones still get written
+static ThreadBuffer &threadBuffer()
+{
+	thread_local ThreadBuffer *buffer = nullptr;
+	if (!buffer)
+	{
+		std::lock_guard<std::mutex> lock(registryMutex);
+		std::vector<std::unique_ptr<ThreadBuffer>> &buffers = registry();
+		buffers.push_back(std::unique_ptr<ThreadBuffer>(new ThreadBuffer()));
+		buffer = buffers.back().get();
+		buffer->id = (unsigned int)buffers.size();
+		buffer->name = "thread " + std::to_string(buffer->id);
+		buffer->events.reserve(1024);
+	}
+	return *buffer;
+}
+
+int64_t CpuProfiler::Now()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - startTime).count();
+}
+
+void CpuProfiler::Record(const char *name, int64_t start, int64_t end)
+{
+	ProfileEvent event;
+	event.name = name;
+	event.start = start;
+	event.end = end;
+	threadBuffer().events.push_back(event);
+}
+
+void CpuProfiler::SetThreadName(const char *name)
+{
+	threadBuffer().name = name;
+}
+
+size_t CpuProfiler::EventCount()
+{
+	std::lock_guard<std::mutex> lock(registryMutex);
+	size_t count = 0;
+	for (size_t i = 0; i < registry().size(); i++)
+		count += registry()[i]->events.size();
+	return count;
+}
+
+static void writeJsonString(std::ostream &out, const std::string &text)
+{
+	out << '"';
+	for (size_t i = 0; i < text.size(); i++)
+	{
+		if (text[i] == '"' || text[i] == '\\')
+			out << '\\';
+		out << text[i];
+	}
+	out << '"';
+}
+
+bool CpuProfiler::WriteChromeTrace(const std::string &path)
+{
+#ifndef G3D_PROFILE
+	std::cout << "ERROR::PROFILER::NOT_BUILT define G3D_PROFILE to record zones" << std::endl;
+#endif
+	std::ofstream out(path.c_str());
+	if (!out)
+		return false;
+
+	std::lock_guard<std::mutex> lock(registryMutex);
+	out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+	bool first = true;
+	char times[64];
+	for (size_t i = 0; i < registry().size(); i++)
+	{
+		const ThreadBuffer &buffer = *registry()[i];
+		out << (first ? "\n" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer.id << ",\"args\":{\"name\":";
+		writeJsonString(out, buffer.name);
+		out << "}}";
+		first = false;
+
+		// complete events, in microseconds
+		for (size_t j = 0; j < buffer.events.size(); j++)
+		{
+			const ProfileEvent &event = buffer.events[j];
+			out << ",\n{\"name\":";
+			writeJsonString(out, event.name);
+			std::snprintf(times, sizeof(times), ",\"ts\":%.3f,\"dur\":%.3f", event.start / 1000.0, (event.end - event.start) / 1000.0);
+			out << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer.id << times << "}";
+		}
+	}
+	out << "\n]}\n";
+	return (bool)out;
+}
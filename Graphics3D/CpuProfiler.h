@@ -0,0 +1,59 @@
+#ifndef CPU_PROFILER_H
+#define CPU_PROFILER_H
+
+#include <cstdint>
+#include <string>
+
+// CPU zone profiler: PROFILE_ZONE("name") times the rest of the enclosing scope, PROFILE_FUNCTION()
+// the whole function. Every thread appends to a buffer of its own, so recording takes no lock; only
+// a thread's first zone registers its buffer. WriteChromeTrace saves all zones in the Chrome trace
+// event format, for chrome://tracing or ui.perfetto.dev. Zone names must be string literals.
+// The macros only expand to anything when G3D_PROFILE is defined.
+
+// one finished zone; times in nanoseconds since the program started
+struct ProfileEvent {
+	const char *name;
+	int64_t start;
+	int64_t end;
+};
+
+class CpuProfiler
+{
+public:
+	static int64_t Now();
+	static void Record(const char *name, int64_t start, int64_t end);
+	// names the calling thread in the trace
+	static void SetThreadName(const char *name);
+
+	// no other thread may be recording meanwhile
+	static bool WriteChromeTrace(const std::string &path);
+	static size_t EventCount();
+};
+
+class ProfileZone
+{
+	const char *name;
+	int64_t start;
+
+public:
+	explicit ProfileZone(const char *name) : name(name), start(CpuProfiler::Now()) { }
+	ProfileZone(const ProfileZone &) = delete;
+	ProfileZone &operator=(const ProfileZone &) = delete;
+	~ProfileZone()
+	{
+		CpuProfiler::Record(name, start, CpuProfiler::Now());
+	}
+};
+
+#ifdef G3D_PROFILE
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_ZONE(name) ProfileZone PROFILE_CONCAT(profileZone, __LINE__)(name)
+#define PROFILE_FUNCTION() PROFILE_ZONE(__FUNCTION__)
+#define PROFILE_THREAD(name) CpuProfiler::SetThreadName(name)
+#else
+#define PROFILE_ZONE(name) ((void)0)
+#define PROFILE_FUNCTION() ((void)0)
+#define PROFILE_THREAD(name) ((void)0)
+#endif
+#endif
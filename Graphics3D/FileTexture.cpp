@@ -1,42 +1,20 @@
 #include "FileTexture.h"
+#include "GLState.h"
 
 // ---------------------------------------------------
 FileTexture::FileTexture(char const* path)
 {
-	glGenTextures(1, &ID);
-
-	int width, height, nrComponents;
-	stbi_set_flip_vertically_on_load(true);
-	unsigned char *data = stbi_load(path, &width, &height, &nrComponents, 0);
-	if (data)
-	{
-		GLenum format;
-		if (nrComponents == 1)
-			format = GL_RED;
-		else if (nrComponents == 3)
-			format = GL_RGB;
-		else if (nrComponents == 4)
-			format = GL_RGBA;
-
-		glBindTexture(GL_TEXTURE_2D, ID);
-		glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-		glGenerateMipmap(GL_TEXTURE_2D);
-
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-		stbi_image_free(data);
-	}
-	else
-	{
-		std::cout << "Texture failed to load at path: " << path << std::endl;
-		stbi_image_free(data);
-	}
+	TextureLoader loader;
+	ID = TextureRegistry::Instance().Acquire(path, loader, true);
+	texture = TextureRef(ID);
+	loader.Finish(path);
+}
+FileTexture::FileTexture(char const* path, TextureLoader &loader)
+{
+	ID = TextureRegistry::Instance().Acquire(path, loader, true);
+	texture = TextureRef(ID);
 }
 void FileTexture::use(GLenum textureUnit)
 {
-	glActiveTexture(textureUnit);
-	glBindTexture(GL_TEXTURE_2D, ID);
+	GLState::BindTexture(textureUnit - GL_TEXTURE0, GL_TEXTURE_2D, ID);
 }
@@ -1,14 +1,19 @@
 #ifndef FILE_TEXTURE_H
 #define FILE_TEXTURE_H
-#include "stb_image.h"
+#include "TextureLoader.h"
+#include "TextureRegistry.h"
 #include <glad/glad.h>
 #include <iostream>
 
 class FileTexture
 {
+	TextureRef texture;
 public:
 	unsigned int ID;
+	// loads the texture right away (or shares it if it is already resident)
 	FileTexture(const char* path);
+	// queues the texture on a shared loader; the data is available after loader.Finish()
+	FileTexture(const char* path, TextureLoader &loader);
 	void use(GLenum textureUnit = GL_TEXTURE0);
 };
-#endif
\ No newline at end of file
+#endif
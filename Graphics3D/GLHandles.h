@@ -0,0 +1,164 @@
+#ifndef GL_HANDLES_H
+#define GL_HANDLES_H
+
+#include <glad/glad.h>
+
+#include "GLState.h"
+
+// Owner of one GL object name, deleted through Traits::Destroy when the handle goes away or
+// takes over another name. Two copies would delete the same name twice, so a handle can only be
+// moved; it converts to the plain name wherever GL expects one.
+template <typename Traits>
+class GLHandle
+{
+	GLuint id;
+
+public:
+	GLHandle() : id(0) { }
+	// adopts an existing name
+	explicit GLHandle(GLuint id) : id(id) { }
+	GLHandle(const GLHandle &) = delete;
+	GLHandle &operator=(const GLHandle &) = delete;
+	GLHandle(GLHandle &&other) noexcept : id(other.id)
+	{
+		other.id = 0;
+	}
+	GLHandle &operator=(GLHandle &&other) noexcept
+	{
+		if (this != &other)
+		{
+			reset(other.id);
+			other.id = 0;
+		}
+		return *this;
+	}
+	~GLHandle()
+	{
+		reset();
+	}
+
+	// a new object; needs a current context
+	static GLHandle Create()
+	{
+		return GLHandle(Traits::Create());
+	}
+
+	GLuint get() const { return id; }
+	operator GLuint() const { return id; }
+
+	// deletes the owned object, if any, and adopts name instead
+	void reset(GLuint name = 0)
+	{
+		if (id)
+			Traits::Destroy(id);
+		id = name;
+	}
+	// gives up ownership without deleting
+	GLuint release()
+	{
+		GLuint name = id;
+		id = 0;
+		return name;
+	}
+};
+
+struct GLBufferTraits {
+	static GLuint Create()
+	{
+		GLuint id;
+		glGenBuffers(1, &id);
+		return id;
+	}
+	static void Destroy(GLuint id)
+	{
+		glDeleteBuffers(1, &id);
+	}
+};
+
+struct GLVertexArrayTraits {
+	static GLuint Create()
+	{
+		GLuint id;
+		glGenVertexArrays(1, &id);
+		return id;
+	}
+	static void Destroy(GLuint id)
+	{
+		glDeleteVertexArrays(1, &id);
+		GLState::ForgetVertexArray(id);
+	}
+};
+
+struct GLTextureTraits {
+	static GLuint Create()
+	{
+		GLuint id;
+		glGenTextures(1, &id);
+		return id;
+	}
+	static void Destroy(GLuint id)
+	{
+		glDeleteTextures(1, &id);
+		GLState::ForgetTexture(id);
+	}
+};
+
+struct GLProgramTraits {
+	static GLuint Create()
+	{
+		return glCreateProgram();
+	}
+	static void Destroy(GLuint id)
+	{
+		glDeleteProgram(id);
+		GLState::ForgetProgram(id);
+	}
+};
+
+struct GLFramebufferTraits {
+	static GLuint Create()
+	{
+		GLuint id;
+		glGenFramebuffers(1, &id);
+		return id;
+	}
+	static void Destroy(GLuint id)
+	{
+		glDeleteFramebuffers(1, &id);
+	}
+};
+
+struct GLRenderbufferTraits {
+	static GLuint Create()
+	{
+		GLuint id;
+		glGenRenderbuffers(1, &id);
+		return id;
+	}
+	static void Destroy(GLuint id)
+	{
+		glDeleteRenderbuffers(1, &id);
+	}
+};
+
+struct GLQueryTraits {
+	static GLuint Create()
+	{
+		GLuint id;
+		glGenQueries(1, &id);
+		return id;
+	}
+	static void Destroy(GLuint id)
+	{
+		glDeleteQueries(1, &id);
+	}
+};
+
+typedef GLHandle<GLBufferTraits> GLBuffer;
+typedef GLHandle<GLVertexArrayTraits> GLVertexArray;
+typedef GLHandle<GLTextureTraits> GLTexture;
+typedef GLHandle<GLProgramTraits> GLProgram;
+typedef GLHandle<GLFramebufferTraits> GLFramebuffer;
+typedef GLHandle<GLRenderbufferTraits> GLRenderbuffer;
+typedef GLHandle<GLQueryTraits> GLQuery;
+#endif
@@ -0,0 +1,155 @@
+#include "GLState.h"
+#include "RenderStats.h"
+
+// a name no call ever binds, so the first bind after Invalidate always goes through
+const GLuint UNKNOWN = 0xFFFFFFFFu;
+const unsigned int TEXTURE_TARGETS = 2;
+
+// starts out as a new context: program, vertex array and textures 0 on unit 0
+static GLuint currentProgram = 0;
+static GLuint currentVertexArray = 0;
+static unsigned int activeUnit = 0;
+static GLuint boundTextures[GLState::MAX_TEXTURE_UNITS][TEXTURE_TARGETS];
+static GLStateStats stats;
+static unsigned int programEpoch = 0;
+
+static unsigned int targetIndex(GLenum target)
+{
+	return target == GL_TEXTURE_BUFFER ? 1 : 0;
+}
+
+void GLState::UseProgram(GLuint program)
+{
+	if (program == currentProgram)
+	{
+		stats.filtered++;
+		return;
+	}
+	glUseProgram(program);
+	currentProgram = program;
+	stats.issued++;
+	RenderStats::CountProgramSwitch();
+}
+
+void GLState::BindVertexArray(GLuint vertexArray)
+{
+	if (vertexArray == currentVertexArray)
+	{
+		stats.filtered++;
+		return;
+	}
+	glBindVertexArray(vertexArray);
+	currentVertexArray = vertexArray;
+	stats.issued++;
+}
+
+void GLState::ActiveTexture(unsigned int unit)
+{
+	if (unit == activeUnit)
+	{
+		stats.filtered++;
+		return;
+	}
+	glActiveTexture(GL_TEXTURE0 + unit);
+	activeUnit = unit;
+	stats.issued++;
+}
+
+void GLState::BindTexture(GLenum target, GLuint texture)
+{
+	// units past the shadowed range are passed through
+	if (activeUnit >= MAX_TEXTURE_UNITS)
+	{
+		glBindTexture(target, texture);
+		stats.issued++;
+		RenderStats::CountTextureBind();
+		return;
+	}
+	GLuint &bound = boundTextures[activeUnit][targetIndex(target)];
+	if (texture == bound)
+	{
+		stats.filtered++;
+		return;
+	}
+	glBindTexture(target, texture);
+	bound = texture;
+	stats.issued++;
+	RenderStats::CountTextureBind();
+}
+
+void GLState::BindTexture(unsigned int unit, GLenum target, GLuint texture)
+{
+	if (unit < MAX_TEXTURE_UNITS && boundTextures[unit][targetIndex(target)] == texture)
+	{
+		stats.filtered++;
+		return;
+	}
+	ActiveTexture(unit);
+	BindTexture(target, texture);
+}
+
+void GLState::ForgetTexture(GLuint texture)
+{
+	// GL unbinds a deleted texture from every unit
+	for (unsigned int unit = 0; unit < MAX_TEXTURE_UNITS; unit++)
+	{
+		for (unsigned int target = 0; target < TEXTURE_TARGETS; target++)
+		{
+			if (boundTextures[unit][target] == texture)
+				boundTextures[unit][target] = 0;
+		}
+	}
+}
+
+void GLState::ForgetProgram(GLuint program)
+{
+	// a deleted program stays in use until another one is, but its name may be reused
+	if (program == currentProgram)
+		currentProgram = UNKNOWN;
+	programEpoch++;
+}
+
+unsigned int GLState::ProgramEpoch()
+{
+	return programEpoch;
+}
+
+void GLState::ForgetVertexArray(GLuint vertexArray)
+{
+	// GL reverts to vertex array 0 when the bound one is deleted
+	if (vertexArray == currentVertexArray)
+		currentVertexArray = 0;
+}
+
+void GLState::Invalidate()
+{
+	currentProgram = UNKNOWN;
+	currentVertexArray = UNKNOWN;
+	activeUnit = UNKNOWN;
+	for (unsigned int unit = 0; unit < MAX_TEXTURE_UNITS; unit++)
+	{
+		for (unsigned int target = 0; target < TEXTURE_TARGETS; target++)
+			boundTextures[unit][target] = UNKNOWN;
+	}
+}
+
+void GLState::CountUniform(bool issued)
+{
+	if (issued)
+	{
+		stats.issued++;
+		RenderStats::CountUniformUpload();
+	}
+	else
+		stats.filtered++;
+}
+
+const GLStateStats &GLState::Stats()
+{
+	return stats;
+}
+
+void GLState::ResetStats()
+{
+	stats = GLStateStats();
+}
@@ -0,0 +1,47 @@
+#ifndef GL_STATE_H
+#define GL_STATE_H
+
+#include <glad/glad.h>
+
+// per-frame counters of the calls that went through the state cache
+struct GLStateStats {
+	// calls passed on to GL
+	unsigned int issued = 0;
+	// calls dropped because GL already was in that state
+	unsigned int filtered = 0;
+};
+
+// Shadow copy of the GL binding state: the current program, the vertex array and the texture
+// bound to each unit. Binds that would not change anything are dropped. Everything that binds
+// these has to go through here, or call Invalidate afterwards; uniform values are filtered by
+// Shader itself and counted here as well. One GL context only.
+class GLState
+{
+public:
+	static const unsigned int MAX_TEXTURE_UNITS = 32;
+
+	static void UseProgram(GLuint program);
+	static void BindVertexArray(GLuint vertexArray);
+	static void ActiveTexture(unsigned int unit);
+	// binds to the active unit; target is GL_TEXTURE_2D or GL_TEXTURE_BUFFER
+	static void BindTexture(GLenum target, GLuint texture);
+	// binds to a unit, switching the active unit only when the binding changes
+	static void BindTexture(unsigned int unit, GLenum target, GLuint texture);
+
+	// a deleted name can be handed out again, so it must not be assumed bound anymore
+	static void ForgetTexture(GLuint texture);
+	static void ForgetProgram(GLuint program);
+	static void ForgetVertexArray(GLuint vertexArray);
+	// counts ForgetProgram calls: caches keyed by program name are stale once it changes, as the
+	// name may have been handed to another program
+	static unsigned int ProgramEpoch();
+	// forgets everything, e.g. after code that binds behind the cache's back
+	static void Invalidate();
+
+	// uniform uploads, counted by Shader
+	static void CountUniform(bool issued);
+
+	static const GLStateStats &Stats();
+	static void ResetStats();
+};
+#endif
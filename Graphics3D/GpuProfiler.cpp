@@ -0,0 +1,182 @@
+#include "GpuProfiler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+GpuProfiler::GpuProfiler()
+{
+	enabled = false;
+	frameNumber = 0;
+	dropped = 0;
+	csv = nullptr;
+}
+
+bool GpuProfiler::SetEnabled(bool enabled)
+{
+	if (enabled)
+	{
+		GLint bits = 0;
+		glGetQueryiv(GL_TIMESTAMP, GL_QUERY_COUNTER_BITS, &bits);
+		if (bits == 0)
+		{
+			std::cout << "ERROR::GPU_PROFILER::NO_TIMESTAMP_COUNTER" << std::endl;
+			enabled = false;
+		}
+	}
+	this->enabled = enabled;
+	return enabled;
+}
+
+void GpuProfiler::SetCsv(std::ostream *out)
+{
+	csv = out;
+	if (csv)
+		*csv << "frame,pass,gpu_ms\n";
+}
+
+unsigned int GpuProfiler::passIndex(const char *name)
+{
+	for (unsigned int i = 0; i < passNames.size(); i++)
+	{
+		if (std::strcmp(passNames[i].c_str(), name) == 0)
+			return i;
+	}
+	passNames.push_back(name);
+	samples.push_back(std::vector<float>());
+	return (unsigned int)passNames.size() - 1;
+}
+
+unsigned int GpuProfiler::timestamp(Frame &frame)
+{
+	if (frame.used == frame.queries.size())
+		frame.queries.push_back(GLQuery::Create());
+	glQueryCounter(frame.queries[frame.used], GL_TIMESTAMP);
+	return frame.used++;
+}
+
+bool GpuProfiler::collect(Frame &frame, bool wait)
+{
+	if (!frame.pending)
+		return true;
+	// queries complete in order, so the last one being done means all of them are
+	if (!wait)
+	{
+		GLint available = 0;
+		glGetQueryObjectiv(frame.queries[frame.used - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+		if (!available)
+			return false;
+	}
+
+	std::vector<GLuint64> times(frame.used);
+	for (unsigned int i = 0; i < frame.used; i++)
+		glGetQueryObjectui64v(frame.queries[i], GL_QUERY_RESULT, &times[i]);
+	for (size_t i = 0; i < frame.ranges.size(); i++)
+	{
+		const Range &range = frame.ranges[i];
+		float ms = (float)((double)(times[range.end] - times[range.begin]) / 1e6);
+		samples[range.pass].push_back(ms);
+		if (csv)
+			*csv << frame.number << "," << passNames[range.pass] << "," << ms << "\n";
+	}
+	frame.pending = false;
+	return true;
+}
+
+void GpuProfiler::BeginFrame()
+{
+	if (!enabled)
+		return;
+
+	// collect what the GPU has finished, oldest first; the oldest is the slot about to be reused
+	for (unsigned int age = GPU_PROFILER_LATENCY; age > 0; age--)
+	{
+		if (frameNumber < age)
+			continue;
+		if (!collect(frames[(frameNumber - age) % GPU_PROFILER_LATENCY], false))
+			break;
+	}
+	Frame &frame = current();
+	if (frame.pending)
+	{
+		frame.pending = false;
+		dropped++;
+	}
+
+	frame.used = 0;
+	frame.ranges.clear();
+	frame.number = frameNumber;
+	open.clear();
+	Begin("frame");
+}
+
+void GpuProfiler::EndFrame()
+{
+	if (!enabled)
+		return;
+	// closes "frame" and anything left open
+	while (!open.empty())
+		End();
+	current().pending = true;
+	frameNumber++;
+}
+
+void GpuProfiler::Begin(const char *pass)
+{
+	if (!enabled)
+		return;
+	Frame &frame = current();
+	Range range;
+	range.pass = passIndex(pass);
+	range.begin = timestamp(frame);
+	range.end = range.begin;
+	open.push_back((unsigned int)frame.ranges.size());
+	frame.ranges.push_back(range);
+}
+
+void GpuProfiler::End()
+{
+	if (!enabled || open.empty())
+		return;
+	Frame &frame = current();
+	frame.ranges[open.back()].end = timestamp(frame);
+	open.pop_back();
+}
+
+void GpuProfiler::Finish()
+{
+	if (!enabled)
+		return;
+	for (unsigned int age = GPU_PROFILER_LATENCY; age > 0; age--)
+	{
+		if (frameNumber >= age)
+			collect(frames[(frameNumber - age) % GPU_PROFILER_LATENCY], true);
+	}
+}
+
+std::vector<GpuPassStats> GpuProfiler::Stats() const
+{
+	std::vector<GpuPassStats> stats;
+	for (size_t i = 0; i < passNames.size(); i++)
+	{
+		if (samples[i].empty())
+			continue;
+		std::vector<float> sorted = samples[i];
+		std::sort(sorted.begin(), sorted.end());
+		double sum = 0.0;
+		for (size_t j = 0; j < sorted.size(); j++)
+			sum += sorted[j];
+
+		GpuPassStats pass;
+		pass.name = passNames[i];
+		pass.samples = (unsigned int)sorted.size();
+		pass.minMs = sorted.front();
+		pass.avgMs = sum / sorted.size();
+		// nearest rank
+		size_t rank = (size_t)std::ceil(0.99 * sorted.size());
+		pass.p99Ms = sorted[rank > 0 ? rank - 1 : 0];
+		stats.push_back(pass);
+	}
+	return stats;
+}
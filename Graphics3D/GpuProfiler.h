@@ -0,0 +1,78 @@
+#ifndef GPU_PROFILER_H
+#define GPU_PROFILER_H
+
+#include <glad/glad.h>
+
+#include "GLHandles.h"
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// frames of queries in flight: a frame's results are read this many frames later, when the GPU
+// has normally finished it, so reading them back never waits
+const unsigned int GPU_PROFILER_LATENCY = 4;
+
+struct GpuPassStats {
+	std::string name;
+	unsigned int samples;
+	double minMs, avgMs, p99Ms;
+};
+
+// Times render passes on the GPU with GL_TIMESTAMP queries (core since 3.3). Begin and End put a
+// timestamp into the command stream; every frame of the ring has its own queries, collected at a
+// later BeginFrame once available. A frame the GPU is still working on when its slot comes round
+// again is dropped rather than waited for. Passes may nest, and the whole frame is timed as "frame".
+// Does nothing until enabled.
+class GpuProfiler
+{
+	struct Range {
+		unsigned int pass;
+		unsigned int begin, end;
+	};
+	struct Frame {
+		std::vector<GLQuery> queries;
+		unsigned int used = 0;
+		std::vector<Range> ranges;
+		uint64_t number = 0;
+		bool pending = false;
+	};
+
+	bool enabled;
+	Frame frames[GPU_PROFILER_LATENCY];
+	uint64_t frameNumber;
+	// ranges begun but not ended yet, innermost last
+	std::vector<unsigned int> open;
+	std::vector<std::string> passNames;
+	// milliseconds of every collected frame, per pass
+	std::vector<std::vector<float>> samples;
+	unsigned int dropped;
+	std::ostream *csv;
+
+	Frame &current() { return frames[frameNumber % GPU_PROFILER_LATENCY]; }
+	unsigned int passIndex(const char *name);
+	unsigned int timestamp(Frame &frame);
+	// reads the frame's results if they are all available
+	bool collect(Frame &frame, bool wait);
+
+public:
+	GpuProfiler();
+
+	// false if the implementation has no timestamp counter
+	bool SetEnabled(bool enabled);
+	bool Enabled() const { return enabled; }
+	// also writes every collected pass as a "frame,pass,gpu_ms" row
+	void SetCsv(std::ostream *out);
+
+	void BeginFrame();
+	void EndFrame();
+	void Begin(const char *pass);
+	void End();
+	// waits for the GPU and collects the frames still in flight, e.g. before reading Stats
+	void Finish();
+
+	std::vector<GpuPassStats> Stats() const;
+	unsigned int DroppedFrames() const { return dropped; }
+};
+#endif
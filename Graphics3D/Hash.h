@@ -0,0 +1,50 @@
+#ifndef HASH_H
+#define HASH_H
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <fstream>
+
+// 64-bit FNV-1a, used to key the on-disk caches against the data they were built from
+const uint64_t FNV_OFFSET_BASIS = 14695981039346656037ULL;
+const uint64_t FNV_PRIME = 1099511628211ULL;
+
+inline uint64_t HashBytes(const void *data, size_t size, uint64_t hash = FNV_OFFSET_BASIS)
+{
+	const unsigned char *bytes = static_cast<const unsigned char*>(data);
+	for (size_t i = 0; i < size; i++)
+	{
+		hash ^= bytes[i];
+		hash *= FNV_PRIME;
+	}
+	return hash;
+}
+
+inline uint64_t HashString(const std::string &str, uint64_t hash = FNV_OFFSET_BASIS)
+{
+	return HashBytes(str.data(), str.size(), hash);
+}
+
+template <typename T>
+inline uint64_t HashValue(const T &value, uint64_t hash = FNV_OFFSET_BASIS)
+{
+	return HashBytes(&value, sizeof(T), hash);
+}
+
+// hashes the whole file; returns false if it could not be read
+inline bool HashFile(const std::string &path, uint64_t &hash)
+{
+	std::ifstream file(path, std::ios::binary);
+	if (!file)
+		return false;
+
+	char buffer[64 * 1024];
+	while (file)
+	{
+		file.read(buffer, sizeof(buffer));
+		hash = HashBytes(buffer, (size_t)file.gcount(), hash);
+	}
+	return file.eof();
+}
+#endif
@@ -0,0 +1,287 @@
+#include "Hud.h"
+#include "GLState.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdio>
+
+const unsigned int GLYPH_WIDTH = 5;
+const unsigned int GLYPH_HEIGHT = 7;
+// glyphs sit in 6x8 cells of the atlas, 16 to a row, so neighbours never bleed into each other
+const unsigned int CELL_WIDTH = GLYPH_WIDTH + 1;
+const unsigned int CELL_HEIGHT = GLYPH_HEIGHT + 1;
+const unsigned int ATLAS_COLUMNS = 16;
+const unsigned int ATLAS_WIDTH = ATLAS_COLUMNS * CELL_WIDTH;
+const unsigned int ATLAS_HEIGHT = 4 * CELL_HEIGHT;
+const char FIRST_CHARACTER = ' ';
+const char LAST_CHARACTER = 'Z';
+// the cell after the last glyph is filled, for solid quads
+const unsigned int SOLID_CELL = LAST_CHARACTER - FIRST_CHARACTER + 1;
+// screen pixels per font pixel
+const float HUD_SCALE = 2.0f;
+const float LINE_HEIGHT = CELL_HEIGHT * HUD_SCALE;
+const float MARGIN = 8.0f;
+const float PADDING = 6.0f;
+const float GRAPH_HEIGHT = 60.0f;
+// the top of the graph, and the line through it
+const float GRAPH_MAX_MS = 1000.0f / 30.0f;
+const float GRAPH_TARGET_MS = 1000.0f / 60.0f;
+
+// one glyph per character from ' ' to 'Z': rows top to bottom, bit 4 is the leftmost column
+static const unsigned char FONT[][GLYPH_HEIGHT] = {
+	{ 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 }, // space
+	{ 0x04, 0x04, 0x04, 0x04, 0x04, 0x00, 0x04 }, // !
+	{ 0x0A, 0x0A, 0x00, 0x00, 0x00, 0x00, 0x00 }, // "
+	{ 0x0A, 0x0A, 0x1F, 0x0A, 0x1F, 0x0A, 0x0A }, // #
+	{ 0x04, 0x0F, 0x14, 0x0E, 0x05, 0x1E, 0x04 }, // $
+	{ 0x18, 0x19, 0x02, 0x04, 0x08, 0x13, 0x03 }, // %
+	{ 0x0C, 0x12, 0x14, 0x08, 0x15, 0x12, 0x0D }, // &
+	{ 0x04, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00 }, // '
+	{ 0x02, 0x04, 0x08, 0x08, 0x08, 0x04, 0x02 }, // (
+	{ 0x08, 0x04, 0x02, 0x02, 0x02, 0x04, 0x08 }, // )
+	{ 0x00, 0x04, 0x15, 0x0E, 0x15, 0x04, 0x00 }, // *
+	{ 0x00, 0x04, 0x04, 0x1F, 0x04, 0x04, 0x00 }, // +
+	{ 0x00, 0x00, 0x00, 0x00, 0x0C, 0x04, 0x08 }, // ,
+	{ 0x00, 0x00, 0x00, 0x1F, 0x00, 0x00, 0x00 }, // -
+	{ 0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C }, // .
+	{ 0x00, 0x01, 0x02, 0x04, 0x08, 0x10, 0x00 }, // /
+	{ 0x0E, 0x11, 0x13, 0x15, 0x19, 0x11, 0x0E }, // 0
+	{ 0x04, 0x0C, 0x04, 0x04, 0x04, 0x04, 0x0E }, // 1
+	{ 0x0E, 0x11, 0x01, 0x02, 0x04, 0x08, 0x1F }, // 2
+	{ 0x1F, 0x02, 0x04, 0x02, 0x01, 0x11, 0x0E }, // 3
+	{ 0x02, 0x06, 0x0A, 0x12, 0x1F, 0x02, 0x02 }, // 4
+	{ 0x1F, 0x10, 0x1E, 0x01, 0x01, 0x11, 0x0E }, // 5
+	{ 0x06, 0x08, 0x10, 0x1E, 0x11, 0x11, 0x0E }, // 6
+	{ 0x1F, 0x01, 0x02, 0x04, 0x08, 0x08, 0x08 }, // 7
+	{ 0x0E, 0x11, 0x11, 0x0E, 0x11, 0x11, 0x0E }, // 8
+	{ 0x0E, 0x11, 0x11, 0x0F, 0x01, 0x02, 0x0C }, // 9
+	{ 0x00, 0x0C, 0x0C, 0x00, 0x0C, 0x0C, 0x00 }, // :
+	{ 0x00, 0x0C, 0x0C, 0x00, 0x0C, 0x04, 0x08 }, // ;
+	{ 0x02, 0x04, 0x08, 0x10, 0x08, 0x04, 0x02 }, // <
+	{ 0x00, 0x00, 0x1F, 0x00, 0x1F, 0x00, 0x00 }, // =
+	{ 0x08, 0x04, 0x02, 0x01, 0x02, 0x04, 0x08 }, // >
+	{ 0x0E, 0x11, 0x01, 0x02, 0x04, 0x00, 0x04 }, // ?
+	{ 0x0E, 0x11, 0x01, 0x0D, 0x15, 0x15, 0x0E }, // @
+	{ 0x0E, 0x11, 0x11, 0x1F, 0x11, 0x11, 0x11 }, // A
+	{ 0x1E, 0x11, 0x11, 0x1E, 0x11, 0x11, 0x1E }, // B
+	{ 0x0E, 0x11, 0x10, 0x10, 0x10, 0x11, 0x0E }, // C
+	{ 0x1C, 0x12, 0x11, 0x11, 0x11, 0x12, 0x1C }, // D
+	{ 0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x1F }, // E
+	{ 0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x10 }, // F
+	{ 0x0E, 0x11, 0x10, 0x17, 0x11, 0x11, 0x0F }, // G
+	{ 0x11, 0x11, 0x11, 0x1F, 0x11, 0x11, 0x11 }, // H
+	{ 0x0E, 0x04, 0x04, 0x04, 0x04, 0x04, 0x0E }, // I
+	{ 0x07, 0x02, 0x02, 0x02, 0x02, 0x12, 0x0C }, // J
+	{ 0x11, 0x12, 0x14, 0x18, 0x14, 0x12, 0x11 }, // K
+	{ 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x1F }, // L
+	{ 0x11, 0x1B, 0x15, 0x15, 0x11, 0x11, 0x11 }, // M
+	{ 0x11, 0x11, 0x19, 0x15, 0x13, 0x11, 0x11 }, // N
+	{ 0x0E, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E }, // O
+	{ 0x1E, 0x11, 0x11, 0x1E, 0x10, 0x10, 0x10 }, // P
+	{ 0x0E, 0x11, 0x11, 0x11, 0x15, 0x12, 0x0D }, // Q
+	{ 0x1E, 0x11, 0x11, 0x1E, 0x14, 0x12, 0x11 }, // R
+	{ 0x0F, 0x10, 0x10, 0x0E, 0x01, 0x01, 0x1E }, // S
+	{ 0x1F, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04 }, // T
+	{ 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E }, // U
+	{ 0x11, 0x11, 0x11, 0x11, 0x11, 0x0A, 0x04 }, // V
+	{ 0x11, 0x11, 0x11, 0x15, 0x15, 0x15, 0x0A }, // W
+	{ 0x11, 0x11, 0x0A, 0x04, 0x0A, 0x11, 0x11 }, // X
+	{ 0x11, 0x11, 0x0A, 0x04, 0x04, 0x04, 0x04 }, // Y
+	{ 0x1F, 0x01, 0x02, 0x04, 0x08, 0x10, 0x1F }, // Z
+};
+
+static void formatCount(char *buffer, size_t size, uint64_t count)
+{
+	if (count >= 10000000)
+		snprintf(buffer, size, "%.1fM", count / 1e6);
+	else if (count >= 10000)
+		snprintf(buffer, size, "%.1fK", count / 1e3);
+	else
+		snprintf(buffer, size, "%u", (unsigned int)count);
+}
+
+static void formatBytes(char *buffer, size_t size, uint64_t bytes)
+{
+	if (bytes >= 1024 * 1024)
+		snprintf(buffer, size, "%.1f MB", bytes / (1024.0 * 1024.0));
+	else if (bytes >= 1024)
+		snprintf(buffer, size, "%.1f KB", bytes / 1024.0);
+	else
+		snprintf(buffer, size, "%u B", (unsigned int)bytes);
+}
+
+Hud::Hud() : shader("hud.vertex.shader", "hud.fragment.shader")
+{
+	std::fill(frameTimes, frameTimes + HUD_GRAPH_FRAMES, 0.0f);
+	nextFrame = 0;
+	buildAtlas();
+
+	shader.use();
+	shader.setInt("atlas", 0);
+
+	VAO = GLVertexArray::Create();
+	VBO = GLBuffer::Create();
+	GLState::BindVertexArray(VAO);
+	glBindBuffer(GL_ARRAY_BUFFER, VBO);
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(HudVertex), (void*)offsetof(HudVertex, Position));
+	glEnableVertexAttribArray(1);
+	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(HudVertex), (void*)offsetof(HudVertex, TexCoords));
+	glEnableVertexAttribArray(2);
+	glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, sizeof(HudVertex), (void*)offsetof(HudVertex, Color));
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void Hud::buildAtlas()
+{
+	// one byte of coverage per texel
+	std::vector<unsigned char> texels(ATLAS_WIDTH * ATLAS_HEIGHT, 0);
+	for (unsigned int glyph = 0; glyph <= SOLID_CELL; glyph++)
+	{
+		unsigned int cellX = glyph % ATLAS_COLUMNS * CELL_WIDTH;
+		unsigned int cellY = glyph / ATLAS_COLUMNS * CELL_HEIGHT;
+		for (unsigned int y = 0; y < CELL_HEIGHT; y++)
+		{
+			for (unsigned int x = 0; x < CELL_WIDTH; x++)
+			{
+				bool set = glyph == SOLID_CELL
+					|| (x < GLYPH_WIDTH && y < GLYPH_HEIGHT && (FONT[glyph][y] >> (GLYPH_WIDTH - 1 - x) & 1));
+				if (set)
+					texels[(cellY + y) * ATLAS_WIDTH + cellX + x] = 255;
+			}
+		}
+	}
+
+	atlas = GLTexture::Create();
+	GLState::BindTexture(GL_TEXTURE_2D, atlas);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, ATLAS_WIDTH, ATLAS_HEIGHT, 0, GL_RED, GL_UNSIGNED_BYTE, &texels[0]);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	// texel exact: the font is only ever drawn at whole multiples of its size
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+}
+
+void Hud::AddFrameTime(float ms)
+{
+	frameTimes[nextFrame] = ms;
+	nextFrame = (nextFrame + 1) % HUD_GRAPH_FRAMES;
+}
+
+void Hud::quad(float x, float y, float width, float height, const glm::vec2 &uvMin, const glm::vec2 &uvMax, const glm::vec4 &color)
+{
+	HudVertex corners[4] = {
+		{ glm::vec2(x, y), glm::vec2(uvMin.x, uvMin.y), color },
+		{ glm::vec2(x + width, y), glm::vec2(uvMax.x, uvMin.y), color },
+		{ glm::vec2(x + width, y + height), glm::vec2(uvMax.x, uvMax.y), color },
+		{ glm::vec2(x, y + height), glm::vec2(uvMin.x, uvMax.y), color }
+	};
+	const unsigned int order[6] = { 0, 1, 2, 0, 2, 3 };
+	for (unsigned int i = 0; i < 6; i++)
+		vertices.push_back(corners[order[i]]);
+}
+
+void Hud::rect(float x, float y, float width, float height, const glm::vec4 &color)
+{
+	// the middle of the solid cell
+	glm::vec2 uv((SOLID_CELL % ATLAS_COLUMNS * CELL_WIDTH + 0.5f * CELL_WIDTH) / ATLAS_WIDTH,
+		(SOLID_CELL / ATLAS_COLUMNS * CELL_HEIGHT + 0.5f * CELL_HEIGHT) / ATLAS_HEIGHT);
+	quad(x, y, width, height, uv, uv, color);
+}
+
+float Hud::text(float x, float y, const std::string &text, const glm::vec4 &color)
+{
+	for (size_t i = 0; i < text.size(); i++)
+	{
+		char character = text[i];
+		if (character >= 'a' && character <= 'z')
+			character = character - 'a' + 'A';
+		if (character > FIRST_CHARACTER && character <= LAST_CHARACTER)
+		{
+			unsigned int glyph = character - FIRST_CHARACTER;
+			glm::vec2 uvMin((float)(glyph % ATLAS_COLUMNS * CELL_WIDTH) / ATLAS_WIDTH, (float)(glyph / ATLAS_COLUMNS * CELL_HEIGHT) / ATLAS_HEIGHT);
+			glm::vec2 uvMax = uvMin + glm::vec2((float)GLYPH_WIDTH / ATLAS_WIDTH, (float)GLYPH_HEIGHT / ATLAS_HEIGHT);
+			quad(x, y, GLYPH_WIDTH * HUD_SCALE, GLYPH_HEIGHT * HUD_SCALE, uvMin, uvMax, color);
+		}
+		x += CELL_WIDTH * HUD_SCALE;
+	}
+	return x;
+}
+
+void Hud::graph(float x, float y, float width, float height)
+{
+	rect(x, y, width, height, glm::vec4(0.0f, 0.0f, 0.0f, 0.4f));
+	float barWidth = width / HUD_GRAPH_FRAMES;
+	// oldest frame on the left
+	for (unsigned int i = 0; i < HUD_GRAPH_FRAMES; i++)
+	{
+		float ms = frameTimes[(nextFrame + i) % HUD_GRAPH_FRAMES];
+		if (ms <= 0.0f)
+			continue;
+		float barHeight = std::min(ms / GRAPH_MAX_MS, 1.0f) * height;
+		glm::vec4 color = ms <= GRAPH_TARGET_MS ? glm::vec4(0.3f, 0.9f, 0.3f, 0.9f)
+			: ms <= GRAPH_MAX_MS ? glm::vec4(0.95f, 0.8f, 0.2f, 0.9f) : glm::vec4(0.95f, 0.25f, 0.2f, 0.9f);
+		rect(x + i * barWidth, y + height - barHeight, barWidth, barHeight, color);
+	}
+	float target = y + height - GRAPH_TARGET_MS / GRAPH_MAX_MS * height;
+	rect(x, target, width, 1.0f, glm::vec4(1.0f, 1.0f, 1.0f, 0.5f));
+}
+
+void Hud::Draw(const RenderCounters &counters, unsigned int width, unsigned int height)
+{
+	// average and worst over the frames in the graph
+	float total = 0.0f, worst = 0.0f;
+	unsigned int frames = 0;
+	for (unsigned int i = 0; i < HUD_GRAPH_FRAMES; i++)
+	{
+		if (frameTimes[i] <= 0.0f)
+			continue;
+		total += frameTimes[i];
+		worst = std::max(worst, frameTimes[i]);
+		frames++;
+	}
+	float average = frames > 0 ? total / frames : 0.0f;
+
+	char triangles[32], bytes[32];
+	formatCount(triangles, sizeof(triangles), counters.triangles);
+	formatBytes(bytes, sizeof(bytes), counters.bufferBytes);
+	char lines[8][64];
+	snprintf(lines[0], sizeof(lines[0]), "FRAME %.2f MS %.0f FPS", average, average > 0.0f ? 1000.0f / average : 0.0f);
+	snprintf(lines[1], sizeof(lines[1]), "WORST %.2f MS", worst);
+	snprintf(lines[2], sizeof(lines[2]), "DRAWS %u", counters.drawCalls);
+	snprintf(lines[3], sizeof(lines[3]), "TRIANGLES %s", triangles);
+	snprintf(lines[4], sizeof(lines[4]), "PROGRAMS %u", counters.programSwitches);
+	snprintf(lines[5], sizeof(lines[5]), "TEXTURES %u", counters.textureBinds);
+	snprintf(lines[6], sizeof(lines[6]), "UNIFORMS %u", counters.uniformUploads);
+	snprintf(lines[7], sizeof(lines[7]), "UPLOADED %s", bytes);
+
+	// a dark panel in the top left corner: the counters, then the graph
+	vertices.clear();
+	float graphWidth = 2.0f * HUD_GRAPH_FRAMES;
+	float panelHeight = 3.0f * PADDING + 8 * LINE_HEIGHT + GRAPH_HEIGHT;
+	rect(MARGIN, MARGIN, graphWidth + 2.0f * PADDING, panelHeight, glm::vec4(0.0f, 0.0f, 0.0f, 0.6f));
+	float y = MARGIN + PADDING;
+	for (unsigned int i = 0; i < 8; i++, y += LINE_HEIGHT)
+		text(MARGIN + PADDING, y, lines[i], glm::vec4(1.0f));
+	graph(MARGIN + PADDING, y + PADDING, graphWidth, GRAPH_HEIGHT);
+
+	// the overlay is not part of what it reports
+	RenderStats::SetCounting(false);
+	shader.use();
+	shader.setVec2("screenSize", (float)width, (float)height);
+	GLState::BindTexture(0, GL_TEXTURE_2D, atlas);
+	GLState::BindVertexArray(VAO);
+	glBindBuffer(GL_ARRAY_BUFFER, VBO);
+	glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(HudVertex), &vertices[0], GL_STREAM_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	glDisable(GL_DEPTH_TEST);
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	glDrawArrays(GL_TRIANGLES, 0, (GLsizei)vertices.size());
+	glDisable(GL_BLEND);
+	glEnable(GL_DEPTH_TEST);
+	RenderStats::SetCounting(true);
+}
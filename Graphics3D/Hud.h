@@ -0,0 +1,53 @@
+#ifndef HUD_H
+#define HUD_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "Shader.h"
+#include "GLHandles.h"
+#include "RenderStats.h"
+
+#include <string>
+#include <vector>
+
+// frames shown in the frame time graph
+const unsigned int HUD_GRAPH_FRAMES = 120;
+
+struct HudVertex {
+	// pixels from the top left corner
+	glm::vec2 Position;
+	glm::vec2 TexCoords;
+	glm::vec4 Color;
+};
+
+// On-screen overlay with a frame's RenderCounters and a graph of the recent frame times. Text comes
+// from a 5x7 bitmap font built into an atlas texture at startup (ASCII 32-90, lower case is shown
+// as upper case); the whole overlay is a single draw. Needs a current GL context.
+class Hud
+{
+	Shader shader;
+	GLTexture atlas;
+	GLVertexArray VAO;
+	GLBuffer VBO;
+	std::vector<HudVertex> vertices;
+	float frameTimes[HUD_GRAPH_FRAMES];
+	unsigned int nextFrame;
+
+	void buildAtlas();
+	void rect(float x, float y, float width, float height, const glm::vec4 &color);
+	void quad(float x, float y, float width, float height, const glm::vec2 &uvMin, const glm::vec2 &uvMax, const glm::vec4 &color);
+	// returns the x after the last character
+	float text(float x, float y, const std::string &text, const glm::vec4 &color);
+	void graph(float x, float y, float width, float height);
+
+public:
+	Hud();
+
+	// milliseconds between two frames; the graph scrolls by one bar per call
+	void AddFrameTime(float ms);
+	// draws over the bound framebuffer, which is width x height pixels; leaves depth testing on
+	// and blending off, as the scene expects
+	void Draw(const RenderCounters &counters, unsigned int width, unsigned int height);
+};
+#endif
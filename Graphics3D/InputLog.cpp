@@ -0,0 +1,55 @@
+#include "InputLog.h"
+
+#include <fstream>
+
+bool InputLog::Save(const std::string &path) const
+{
+	std::ofstream out(path, std::ios::binary | std::ios::trunc);
+	if (!out)
+		return false;
+
+	InputLogHeader header;
+	header.magic = INPUT_LOG_MAGIC;
+	header.version = INPUT_LOG_VERSION;
+	header.frameCount = (uint32_t)frames.size();
+	out.write((const char*)&header, sizeof(header));
+	if (!frames.empty())
+		out.write((const char*)&frames[0], frames.size() * sizeof(InputState));
+	return (bool)out;
+}
+
+bool InputLog::Load(const std::string &path)
+{
+	std::ifstream in(path, std::ios::binary);
+	if (!in)
+		return false;
+
+	InputLogHeader header;
+	if (!in.read((char*)&header, sizeof(header)))
+		return false;
+	if (header.magic != INPUT_LOG_MAGIC || header.version != INPUT_LOG_VERSION)
+		return false;
+
+	// a damaged count must not size the allocation: the frames have to be in the file
+	std::streamoff frameStart = in.tellg();
+	in.seekg(0, std::ios::end);
+	std::streamoff remaining = in.tellg() - frameStart;
+	in.seekg(frameStart);
+	if (remaining < 0 || (uint64_t)header.frameCount * sizeof(InputState) > (uint64_t)remaining)
+		return false;
+
+	std::vector<InputState> loaded(header.frameCount);
+	if (!loaded.empty() && !in.read((char*)&loaded[0], loaded.size() * sizeof(InputState)))
+		return false;
+	frames.swap(loaded);
+	playhead = 0;
+	return true;
+}
+
+bool InputLog::Next(InputState &state)
+{
+	if (playhead >= frames.size())
+		return false;
+	state = frames[playhead++];
+	return true;
+}
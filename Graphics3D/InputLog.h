@@ -0,0 +1,72 @@
+#ifndef INPUT_LOG_H
+#define INPUT_LOG_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// the controls of the scene, as bits of InputState::buttons
+enum InputButton {
+	INPUT_CAR_FORWARD = 1 << 0,     // up
+	INPUT_CAR_BACKWARD = 1 << 1,    // down
+	INPUT_CAR_LEFT = 1 << 2,        // left
+	INPUT_CAR_RIGHT = 1 << 3,       // right
+	INPUT_CAMERA_FORWARD = 1 << 4,  // W
+	INPUT_CAMERA_BACKWARD = 1 << 5, // S
+	INPUT_CAMERA_LEFT = 1 << 6,     // A
+	INPUT_CAMERA_RIGHT = 1 << 7,    // D
+	INPUT_NEXT_CAMERA = 1 << 8,     // C
+	INPUT_TOGGLE_FOG = 1 << 9,      // F
+	INPUT_TOGGLE_NIGHT = 1 << 10,   // N
+	INPUT_TOGGLE_GOURAUD = 1 << 11, // G
+	INPUT_REFLECTOR_UP = 1 << 12,   // Y
+	INPUT_REFLECTOR_DOWN = 1 << 13, // H
+	INPUT_QUIT = 1 << 14,           // escape
+	INPUT_TOGGLE_HUD = 1 << 15      // F1
+};
+
+// everything one frame of the simulation depends on
+struct InputState {
+	// InputButton bits held down during the frame
+	uint32_t buttons;
+	// simulated time the frame advances, in seconds
+	float deltaTime;
+	// mouse movement since the previous frame (y up) and scroll wheel movement
+	float mouseX, mouseY;
+	float scroll;
+};
+static_assert(sizeof(InputState) == 20, "InputState is stored as is");
+
+// Per-frame input of a session, recorded to a file and played back from it, so a benchmark can
+// take exactly the same path through the scene every run.
+//
+// File layout:
+//   InputLogHeader
+//   InputState[frameCount]
+const uint32_t INPUT_LOG_MAGIC = 0x49443347; // "G3DI"
+const uint32_t INPUT_LOG_VERSION = 1;
+
+struct InputLogHeader {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t frameCount;
+};
+
+class InputLog
+{
+	std::vector<InputState> frames;
+	size_t playhead;
+
+public:
+	InputLog() : playhead(0) { }
+
+	void Record(const InputState &state) { frames.push_back(state); }
+	bool Save(const std::string &path) const;
+	// replaces the frames with the file's and rewinds
+	bool Load(const std::string &path);
+	// the next recorded frame; false once all of them have been played
+	bool Next(InputState &state);
+
+	size_t FrameCount() const { return frames.size(); }
+};
+#endif
@@ -0,0 +1,117 @@
+#include "Material.h"
+#include "GLState.h"
+
+#include <cstring>
+
+const char *TextureTypeName(TextureType type)
+{
+	static const char *names[TEXTURE_TYPE_COUNT] = { "texture_diffuse", "texture_specular", "texture_normal", "texture_height" };
+	return type < TEXTURE_TYPE_COUNT ? names[type] : "";
+}
+
+static GLuint defaultTexture(TextureType type)
+{
+	// created on first use and never deleted, as they may be needed until the context goes away
+	static GLuint textures[TEXTURE_TYPE_COUNT] = { 0 };
+	if (textures[type] == 0)
+	{
+		static const unsigned char texels[TEXTURE_TYPE_COUNT][4] = { { 255, 255, 255, 255 }, { 0, 0, 0, 255 }, { 128, 128, 255, 255 }, { 0, 0, 0, 255 } };
+		glGenTextures(1, &textures[type]);
+		GLState::BindTexture(DEFAULT_TEXTURE_UNIT + type, GL_TEXTURE_2D, textures[type]);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, texels[type]);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	}
+	return textures[type];
+}
+
+Material::Material(const std::vector<Texture> &textures)
+{
+	// the N in texture_diffuseN counts the textures of each type
+	unsigned int counts[TEXTURE_TYPE_COUNT] = { 0 };
+	slots.resize(textures.size());
+	for (size_t i = 0; i < textures.size(); i++)
+	{
+		std::string name = TextureTypeName(textures[i].type);
+		std::string number = std::to_string(++counts[textures[i].type]);
+
+		slots[i].texture = textures[i].id;
+		slots[i].shininess = textures[i].shininess;
+		slots[i].samplerName = name + number;
+		slots[i].shininessName = name + number + "_shininess";
+	}
+	bindingsEpoch = GLState::ProgramEpoch();
+}
+
+const Material::ProgramBinding &Material::binding(const Shader &shader) const
+{
+	// program names are reused after deletion, so any deletion drops what was resolved
+	if (bindingsEpoch != GLState::ProgramEpoch())
+	{
+		bindings.clear();
+		bindingsEpoch = GLState::ProgramEpoch();
+	}
+
+	// a handful of programs at most, so a linear search beats hashing
+	for (size_t i = 0; i < bindings.size(); i++)
+	{
+		if (bindings[i].program == shader.ID)
+			return bindings[i];
+	}
+
+	ProgramBinding binding;
+	binding.program = shader.ID;
+	for (size_t i = 0; i < slots.size(); i++)
+	{
+		binding.samplers.push_back(shader.uniform(slots[i].samplerName));
+		binding.shininess.push_back(shader.uniform(slots[i].shininessName));
+	}
+
+	// the program's texture samplers this material has nothing for
+	GLint uniformCount = 0;
+	glGetProgramiv(shader.ID, GL_ACTIVE_UNIFORMS, &uniformCount);
+	for (GLint i = 0; i < uniformCount; i++)
+	{
+		char name[64];
+		GLsizei length = 0;
+		GLint size = 0;
+		GLenum type = 0;
+		glGetActiveUniform(shader.ID, (GLuint)i, sizeof(name), &length, &size, &type, name);
+		if (type != GL_SAMPLER_2D)
+			continue;
+		bool provided = false;
+		for (size_t j = 0; j < slots.size() && !provided; j++)
+			provided = slots[j].samplerName == name;
+		for (unsigned int t = 0; t < TEXTURE_TYPE_COUNT && !provided; t++)
+		{
+			const char *prefix = TextureTypeName((TextureType)t);
+			if (strncmp(name, prefix, strlen(prefix)) == 0)
+			{
+				UnsetSampler unset;
+				unset.sampler = shader.uniform(name);
+				unset.type = (TextureType)t;
+				binding.unset.push_back(unset);
+				break;
+			}
+		}
+	}
+	bindings.push_back(binding);
+	return bindings.back();
+}
+
+void Material::Bind(const Shader &shader) const
+{
+	const ProgramBinding &resolved = binding(shader);
+	for (unsigned int i = 0; i < slots.size(); i++)
+	{
+		GLState::BindTexture(i, GL_TEXTURE_2D, slots[i].texture);
+		shader.setInt(resolved.samplers[i], (int)i);
+		shader.setFloat(resolved.shininess[i], slots[i].shininess);
+	}
+	for (size_t i = 0; i < resolved.unset.size(); i++)
+	{
+		unsigned int unit = DEFAULT_TEXTURE_UNIT + resolved.unset[i].type;
+		GLState::BindTexture(unit, GL_TEXTURE_2D, defaultTexture(resolved.unset[i].type));
+		shader.setInt(resolved.unset[i].sampler, (int)unit);
+	}
+}
@@ -0,0 +1,72 @@
+#ifndef MATERIAL_H
+#define MATERIAL_H
+
+#include <glad/glad.h>
+
+#include "Shader.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+enum TextureType : uint32_t {
+	TEXTURE_DIFFUSE,
+	TEXTURE_SPECULAR,
+	TEXTURE_NORMAL,
+	TEXTURE_HEIGHT,
+	TEXTURE_TYPE_COUNT
+};
+
+// the sampler name prefix in the shaders ("texture_diffuse", ...)
+const char *TextureTypeName(TextureType type);
+
+// units of the 1x1 placeholders that samplers without a texture in the material read: white
+// diffuse, black specular and height, flat normal; below the units ClusteredLights uses
+const unsigned int DEFAULT_TEXTURE_UNIT = 9;
+
+// A texture used by a mesh. The GL name is the handle into TextureRegistry, and the path
+// (relative to the model, as the material spells it) is interned in StringPool.
+struct Texture {
+	unsigned int id;
+	uint32_t path;
+	TextureType type;
+	float shininess;
+};
+static_assert(sizeof(Texture) == 16, "Texture is meant to stay small");
+
+// The textures of a mesh with their uniform names worked out once ("texture_diffuse1", ...).
+// The sampler and shininess locations are resolved the first time the material is bound with
+// a program and cached per program, so binding is a loop over integers. The program's other
+// texture_* samplers are pointed at the placeholders, rather than at whatever unit the previous
+// material left them on.
+class Material
+{
+	struct Slot {
+		unsigned int texture;
+		float shininess;
+		std::string samplerName;
+		std::string shininessName;
+	};
+	struct UnsetSampler {
+		Uniform sampler;
+		TextureType type;
+	};
+	struct ProgramBinding {
+		unsigned int program;
+		std::vector<Uniform> samplers;
+		std::vector<Uniform> shininess;
+		std::vector<UnsetSampler> unset;
+	};
+	std::vector<Slot> slots;
+	mutable std::vector<ProgramBinding> bindings;
+	// GLState::ProgramEpoch when bindings was last valid
+	mutable unsigned int bindingsEpoch;
+
+	const ProgramBinding &binding(const Shader &shader) const;
+public:
+	explicit Material(const std::vector<Texture> &textures);
+	// binds texture i to unit i and points the samplers at them; the shader must be in use
+	void Bind(const Shader &shader) const;
+	size_t TextureCount() const { return slots.size(); }
+};
+#endif
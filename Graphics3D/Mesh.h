@@ -7,15 +7,23 @@
 #include <glm/gtc/matrix_transform.hpp>
 
 #include "Shader.h"
+#include "GLState.h"
+#include "RenderStats.h"
+#include "GLHandles.h"
+#include "VertexFormat.h"
+#include "Bounds.h"
+#include "Material.h"
 
 #include "assimp/Importer.hpp"
 #include "assimp/scene.h"
 #include "assimp/postprocess.h"
 
+#include <cstring>
 #include <string>
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <memory>
 #include <vector>
 using namespace std;
 
@@ -32,13 +40,55 @@ struct Vertex {
 	glm::vec3 Bitangent;
 };
 
-struct Texture {
-	unsigned int id;
-	string type;
-	aiString path; // we store the path of the texture to compare with other textures
-	float shininess;
+// per-instance attributes of an instanced draw
+struct InstanceData {
+	// locations 5-8
+	glm::mat4 Model;
+	// locations 9-11
+	glm::mat3 NormalMatrix;
 };
 
+// permutation bits (see ShaderPermutations) that the geometry decides rather than the scene; the
+// shaders that draw meshes list "INSTANCED" and "COMPACT_VERTEX" as their features 3 and 4
+const unsigned int INSTANCED_FEATURE = 1 << 3;
+const unsigned int COMPACT_VERTEX_FEATURE = 1 << 4;
+
+// the uniforms a mesh sets before it is drawn, resolved once per program so drawing never looks
+// up a name; unused ones (e.g. without COMPACT_VERTEX) stay -1
+struct MeshUniforms {
+	Uniform positionOffset;
+	Uniform positionScale;
+
+	MeshUniforms() { }
+	explicit MeshUniforms(const Shader &shader)
+		: positionOffset(shader.uniform("positionOffset")), positionScale(shader.uniform("positionScale")) { }
+};
+
+// a mesh's geometry in the layout of its GPU buffers (see Mesh::Pack); the mesh cache stores it as
+// is, so a cached mesh goes to glBufferData straight from the mapped file
+struct PackedGeometry {
+	const void *vertexData;
+	unsigned int vertexCount;
+	const void *indexData;
+	unsigned int indexCount;
+	// GL_UNSIGNED_SHORT whenever every index fits, GL_UNSIGNED_INT otherwise
+	GLenum indexType;
+	AABB bounds;
+	BoundingSphere boundingSphere;
+	// compact positions are stored relative to the mesh bounds: position = offset + scale * stored
+	glm::vec3 positionOffset;
+	glm::vec3 positionScale;
+};
+
+// What a mesh keeps in system memory once its buffers are uploaded
+enum CpuResidency {
+	// vertices and indices, e.g. to write the mesh cache or rebuild the buffers
+	CPU_RESIDENCY_KEEP,
+	// nothing: the GPU buffers are the only copy
+	CPU_RESIDENCY_DISCARD,
+	// positions and indices, for CPU queries such as picking or collision
+	CPU_RESIDENCY_POSITIONS
+};
 
 class Mesh {
 public:
@@ -46,84 +96,311 @@ public:
 	vector<Vertex> vertices;
 	vector<unsigned int> indices;
 	vector<Texture> textures;
-	unsigned int VAO;
+	// the vertex positions alone, in place of vertices under CPU_RESIDENCY_POSITIONS
+	vector<glm::vec3> positions;
+	// the textures prepared for binding; meshes with the same textures share one
+	shared_ptr<Material> material;
+	GLVertexArray VAO;
+
+	/*  GPU Layout  */
+	VertexFormat format;
+	bool hasTangents;
+	// GL_UNSIGNED_SHORT whenever every index fits, GL_UNSIGNED_INT otherwise
+	GLenum indexType;
+	unsigned int vertexCount;
+	unsigned int indexCount;
+
+	/*  Bounds (model space)  */
+	AABB bounds;
+	BoundingSphere boundingSphere;
+	// compact positions are stored relative to the mesh bounds: position = offset + scale * stored
+	glm::vec3 positionOffset;
+	glm::vec3 positionScale;
 
 	/*  Functions  */
-	// constructor
-	Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures)
+	// constructor; pass the arrays as rvalues to hand them over without a copy
+	Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures, VertexFormat format = VERTEX_FORMAT_FULL, bool tangents = false, shared_ptr<Material> material = nullptr)
 	{
-		this->vertices = vertices;
-		this->indices = indices;
-		this->textures = textures;
+		this->vertices = std::move(vertices);
+		this->indices = std::move(indices);
+		this->textures = std::move(textures);
+		this->material = material ? material : make_shared<Material>(this->textures);
+		this->format = format;
+		this->hasTangents = tangents;
 
 		// now that we have all the required data, set the vertex buffers and its attribute pointers.
-		setupMesh();
+		vector<unsigned char> vertexScratch, indexScratch;
+		setupMesh(Pack(this->vertices.data(), this->vertices.size(), this->indices.data(), this->indices.size(), format, tangents, vertexScratch, indexScratch));
 	}
 
-	// render the mesh
-	void Draw(Shader shader)
+	// constructor over geometry already in the GPU layout of format (e.g. a mapped mesh cache): the
+	// buffers are filled straight from that memory, and only the CPU copy residency asks for is
+	// unpacked from it
+	Mesh(const PackedGeometry &geometry, vector<Texture> textures, VertexFormat format = VERTEX_FORMAT_FULL, bool tangents = false, shared_ptr<Material> material = nullptr, CpuResidency residency = CPU_RESIDENCY_KEEP)
+	{
+		this->textures = std::move(textures);
+		this->material = material ? material : make_shared<Material>(this->textures);
+		this->format = format;
+		this->hasTangents = tangents;
+
+		setupMesh(geometry);
+		if (residency != CPU_RESIDENCY_DISCARD)
+			unpack(geometry, residency);
+	}
+
+	// the mesh owns its GL objects: it can be moved (e.g. when the vector of meshes grows) but not copied
+	Mesh(Mesh &&) = default;
+	Mesh &operator=(Mesh &&) = default;
+
+	// size of one vertex in the GPU buffer
+	static size_t VertexStride(VertexFormat format, bool tangents)
 	{
-		// bind appropriate textures
-		unsigned int diffuseNr = 1;
-		unsigned int specularNr = 1;
-		unsigned int normalNr = 1;
-		unsigned int heightNr = 1;
-		for (unsigned int i = 0; i < textures.size(); i++)
+		if (format == VERTEX_FORMAT_COMPACT)
+			return tangents ? sizeof(CompactTangentVertex) : sizeof(CompactVertex);
+		return sizeof(Vertex);
+	}
+
+	// converts full vertices and 32-bit indices into the GPU layout; the arrays that change go to the
+	// scratch vectors, the others are pointed to, so the inputs and the scratch must outlive the result
+	static PackedGeometry Pack(const Vertex *vertexData, size_t vertexCount, const unsigned int *indexData, size_t indexCount, VertexFormat format, bool tangents, vector<unsigned char> &vertexScratch, vector<unsigned char> &indexScratch)
+	{
+		PackedGeometry geometry;
+		geometry.vertexCount = (unsigned int)vertexCount;
+		geometry.indexCount = (unsigned int)indexCount;
+		computeBounds(vertexData, vertexCount, geometry.bounds, geometry.boundingSphere);
+
+		if (vertexCount <= 65536)
 		{
-			glActiveTexture(GL_TEXTURE0 + i); // active proper texture unit before binding
-			// retrieve texture number (the N in diffuse_textureN)
-			string number;
-			string name = textures[i].type;
-			if (name == "texture_diffuse")
-				number = std::to_string(diffuseNr++);
-			else if (name == "texture_specular")
-				number = std::to_string(specularNr++); // transfer unsigned int to stream
-			else if (name == "texture_normal")
-				number = std::to_string(normalNr++); // transfer unsigned int to stream
-			else if (name == "texture_height")
-				number = std::to_string(heightNr++); // transfer unsigned int to stream
+			// every index fits in 16 bits: half the index memory and bandwidth
+			geometry.indexType = GL_UNSIGNED_SHORT;
+			indexScratch.resize(indexCount * sizeof(unsigned short));
+			unsigned short *shortIndices = (unsigned short*)indexScratch.data();
+			for (size_t i = 0; i < indexCount; i++)
+				shortIndices[i] = (unsigned short)indexData[i];
+			geometry.indexData = indexScratch.data();
+		}
+		else
+		{
+			geometry.indexType = GL_UNSIGNED_INT;
+			geometry.indexData = indexData;
+		}
 
-			// now set the sampler to the correct texture unit
-			glUniform1i(glGetUniformLocation(shader.ID, (name + number).c_str()), i);
-			// and finally bind the texture
-			glBindTexture(GL_TEXTURE_2D, textures[i].id);
+		if (format == VERTEX_FORMAT_COMPACT)
+			packCompactVertices(vertexData, vertexCount, tangents, geometry, vertexScratch);
+		else
+		{
+			geometry.positionOffset = glm::vec3(0.0f);
+			geometry.positionScale = glm::vec3(1.0f);
+			// A great thing about structs is that their memory layout is sequential for all its items.
+			// The effect is that we can simply pass a pointer to the struct and it translates perfectly to a glm::vec3/2 array which
+			// again translates to 3/2 floats which translates to a byte array.
+			geometry.vertexData = vertexData;
+		}
+		return geometry;
+	}
 
-			glUniform1f(glGetUniformLocation(shader.ID, (name + number + "_shininess").c_str()), textures[i].shininess);
+	// drops the CPU copy of the geometry as residency says; the GPU buffers, bounds and textures stay
+	void ApplyResidency(CpuResidency residency)
+	{
+		if (residency == CPU_RESIDENCY_KEEP)
+			return;
+		if (residency == CPU_RESIDENCY_POSITIONS)
+		{
+			// applied already, or built with it: the positions are all that is left
+			if (vertices.empty())
+				return;
+			positions.resize(vertices.size());
+			for (size_t i = 0; i < vertices.size(); i++)
+				positions[i] = vertices[i].Position;
 		}
+		else
+			vector<unsigned int>().swap(indices);
+		// swapped with an empty vector, as clear() would keep the memory
+		vector<Vertex>().swap(vertices);
+	}
 
-		// draw mesh
-		glBindVertexArray(VAO);
-		glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
-		glBindVertexArray(0);
+	// system memory held by the geometry arrays
+	size_t CpuBytes() const
+	{
+		return vertices.capacity() * sizeof(Vertex) + indices.capacity() * sizeof(unsigned int) + positions.capacity() * sizeof(glm::vec3);
+	}
+
+	// video memory of the vertex and index buffers
+	size_t GpuBytes() const
+	{
+		return vertexCount * VertexStride(format, hasTangents) + indexCount * (indexType == GL_UNSIGNED_SHORT ? sizeof(unsigned short) : sizeof(unsigned int));
+	}
+
+	// the permutation bits the shader drawing this mesh needs
+	unsigned int ShaderFeatures(bool instanced) const
+	{
+		return (instanced ? INSTANCED_FEATURE : 0) | (format == VERTEX_FORMAT_COMPACT ? COMPACT_VERTEX_FEATURE : 0);
+	}
+
+	// render the mesh; the shader must be the variant ShaderFeatures(false) asks for
+	void Draw(Shader &shader, const MeshUniforms &uniforms)
+	{
+		BindMaterial(shader);
+		SetUniforms(shader, uniforms);
+		DrawGeometry();
+	}
+
+	// render the mesh instanceCount times in one call; the shader reads each instance's matrices
+	// from the buffer given to SetInstanceBuffer, so it must be the ShaderFeatures(true) variant
+	void DrawInstanced(Shader &shader, const MeshUniforms &uniforms, unsigned int instanceCount)
+	{
+		BindMaterial(shader);
+		SetUniforms(shader, uniforms);
+		DrawGeometry(instanceCount);
+	}
+
+	// binds the textures and sets the sampler and shininess uniforms; consecutive meshes with the
+	// same material (see RenderQueue) only need this once
+	void BindMaterial(Shader &shader)
+	{
+		material->Bind(shader);
+	}
 
-		// always good practice to set everything back to defaults once configured.
-		glActiveTexture(GL_TEXTURE0);
+	// sets what decoding the vertices takes, constant per mesh: a run of draws of the same mesh
+	// (see RenderQueue) only needs this once
+	void SetUniforms(const Shader &shader, const MeshUniforms &uniforms) const
+	{
+		if (format == VERTEX_FORMAT_COMPACT)
+		{
+			shader.setVec3(uniforms.positionOffset, positionOffset);
+			shader.setVec3(uniforms.positionScale, positionScale);
+		}
+	}
+
+	// issues the draw; instanceCount 0 is a plain draw
+	void DrawGeometry(unsigned int instanceCount = 0)
+	{
+		// left bound: the next draw of this mesh skips the bind
+		GLState::BindVertexArray(VAO);
+		if (instanceCount > 0)
+			glDrawElementsInstanced(GL_TRIANGLES, indexCount, indexType, 0, instanceCount);
+		else
+			glDrawElements(GL_TRIANGLES, indexCount, indexType, 0);
+		RenderStats::CountDraw(indexCount, instanceCount > 0 ? instanceCount : 1);
+	}
+
+	// sources the per-instance attributes from a buffer of InstanceData
+	void SetInstanceBuffer(unsigned int instanceVBO)
+	{
+		GLState::BindVertexArray(VAO);
+		glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+		// a matrix attribute takes one location per column
+		for (unsigned int i = 0; i < 4; i++)
+		{
+			glEnableVertexAttribArray(5 + i);
+			glVertexAttribPointer(5 + i, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData), (void*)(offsetof(InstanceData, Model) + i * sizeof(glm::vec4)));
+			glVertexAttribDivisor(5 + i, 1);
+		}
+		for (unsigned int i = 0; i < 3; i++)
+		{
+			glEnableVertexAttribArray(9 + i);
+			glVertexAttribPointer(9 + i, 3, GL_FLOAT, GL_FALSE, sizeof(InstanceData), (void*)(offsetof(InstanceData, NormalMatrix) + i * sizeof(glm::vec3)));
+			glVertexAttribDivisor(9 + i, 1);
+		}
+		GLState::BindVertexArray(0);
 	}
 
 private:
 	/*  Render data  */
-	unsigned int VBO, EBO;
+	GLBuffer VBO, EBO;
 
 	/*  Functions    */
 	// initializes all the buffer objects/arrays
-	void setupMesh()
+	void setupMesh(const PackedGeometry &geometry)
 	{
+		bounds = geometry.bounds;
+		boundingSphere = geometry.boundingSphere;
+		positionOffset = geometry.positionOffset;
+		positionScale = geometry.positionScale;
+		vertexCount = geometry.vertexCount;
+		indexCount = geometry.indexCount;
+		indexType = geometry.indexType;
+
 		// create buffers/arrays
-		glGenVertexArrays(1, &VAO);
-		glGenBuffers(1, &VBO);
-		glGenBuffers(1, &EBO);
+		VAO = GLVertexArray::Create();
+		VBO = GLBuffer::Create();
+		EBO = GLBuffer::Create();
+
+		GLState::BindVertexArray(VAO);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+		size_t indexBytes = indexCount * (indexType == GL_UNSIGNED_SHORT ? sizeof(unsigned short) : sizeof(unsigned int));
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexBytes, geometry.indexData, GL_STATIC_DRAW);
+		RenderStats::CountBufferUpload(indexBytes);
 
-		glBindVertexArray(VAO);
 		// load data into vertex buffers
 		glBindBuffer(GL_ARRAY_BUFFER, VBO);
-		// A great thing about structs is that their memory layout is sequential for all its items.
-		// The effect is that we can simply pass a pointer to the struct and it translates perfectly to a glm::vec3/2 array which
-		// again translates to 3/2 floats which translates to a byte array.
-		glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);
+		size_t stride = VertexStride(format, hasTangents);
+		glBufferData(GL_ARRAY_BUFFER, vertexCount * stride, geometry.vertexData, GL_STATIC_DRAW);
+		RenderStats::CountBufferUpload(vertexCount * stride);
+		if (format == VERTEX_FORMAT_COMPACT)
+			setupCompactAttributes(stride);
+		else
+			setupFullAttributes();
 
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-		glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
+		GLState::BindVertexArray(0);
+	}
 
+	static void computeBounds(const Vertex *vertexData, size_t vertexCount, AABB &bounds, BoundingSphere &boundingSphere)
+	{
+		bounds.min = bounds.max = glm::vec3(0.0f);
+		if (vertexCount > 0)
+			bounds.min = bounds.max = vertexData[0].Position;
+		for (size_t i = 1; i < vertexCount; i++)
+		{
+			bounds.min = glm::min(bounds.min, vertexData[i].Position);
+			bounds.max = glm::max(bounds.max, vertexData[i].Position);
+		}
+
+		// centred on the box, but only as large as the furthest vertex
+		boundingSphere.center = bounds.Center();
+		float radiusSquared = 0.0f;
+		for (size_t i = 0; i < vertexCount; i++)
+		{
+			glm::vec3 offset = vertexData[i].Position - boundingSphere.center;
+			radiusSquared = glm::max(radiusSquared, glm::dot(offset, offset));
+		}
+		boundingSphere.radius = std::sqrt(radiusSquared);
+	}
+
+	static void packCompactVertices(const Vertex *vertexData, size_t vertexCount, bool tangents, PackedGeometry &geometry, vector<unsigned char> &packed)
+	{
+		// quantize positions into the mesh bounds
+		geometry.positionOffset = geometry.bounds.Center();
+		geometry.positionScale = glm::max(geometry.bounds.Extent(), glm::vec3(1e-6f));
+
+		size_t stride = VertexStride(VERTEX_FORMAT_COMPACT, tangents);
+		packed.resize(vertexCount * stride);
+		for (size_t i = 0; i < vertexCount; i++)
+		{
+			const Vertex &vertex = vertexData[i];
+			CompactTangentVertex compact;
+			glm::vec3 position = (vertex.Position - geometry.positionOffset) / geometry.positionScale;
+			compact.Position[0] = PackSnorm16(position.x);
+			compact.Position[1] = PackSnorm16(position.y);
+			compact.Position[2] = PackSnorm16(position.z);
+			glm::vec2 normal = OctEncode(vertex.Normal);
+			compact.Normal[0] = PackSnorm16(normal.x);
+			compact.Normal[1] = PackSnorm16(normal.y);
+			compact.TexCoords[0] = glm::packHalf1x16(vertex.TexCoords.x);
+			compact.TexCoords[1] = glm::packHalf1x16(vertex.TexCoords.y);
+			// for a normal mapping shader to rebuild the bitangent as cross(normal, tangent) * sign
+			bool flipped = glm::dot(glm::cross(vertex.Normal, vertex.Tangent), vertex.Bitangent) < 0.0f;
+			compact.Position[3] = flipped ? -32767 : 32767;
+			glm::vec2 tangent = OctEncode(vertex.Tangent);
+			compact.Tangent[0] = PackSnorm16(tangent.x);
+			compact.Tangent[1] = PackSnorm16(tangent.y);
+			memcpy(&packed[i * stride], &compact, stride);
+		}
+		geometry.vertexData = packed.data();
+	}
+
+	void setupFullAttributes()
+	{
 		// set the vertex attribute pointers
 		// vertex Positions
 		glEnableVertexAttribArray(0);
@@ -134,14 +411,83 @@ private:
 		// vertex texture coords
 		glEnableVertexAttribArray(2);
 		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, TexCoords));
-		// vertex tangent
-		glEnableVertexAttribArray(3);
-		glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Tangent));
-		// vertex bitangent
-		glEnableVertexAttribArray(4);
-		glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Bitangent));
-
-		glBindVertexArray(0);
+		if (hasTangents)
+		{
+			// vertex tangent
+			glEnableVertexAttribArray(3);
+			glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Tangent));
+			// vertex bitangent
+			glEnableVertexAttribArray(4);
+			glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Bitangent));
+		}
+	}
+
+	void setupCompactAttributes(size_t stride)
+	{
+		// vertex Positions (w: bitangent sign)
+		glEnableVertexAttribArray(0);
+		glVertexAttribPointer(0, 4, GL_SHORT, GL_TRUE, (GLsizei)stride, (void*)offsetof(CompactTangentVertex, Position));
+		// vertex normals, octahedral
+		glEnableVertexAttribArray(1);
+		glVertexAttribPointer(1, 2, GL_SHORT, GL_TRUE, (GLsizei)stride, (void*)offsetof(CompactTangentVertex, Normal));
+		// vertex texture coords
+		glEnableVertexAttribArray(2);
+		glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, (GLsizei)stride, (void*)offsetof(CompactTangentVertex, TexCoords));
+		if (hasTangents)
+		{
+			// vertex tangent, octahedral
+			glEnableVertexAttribArray(3);
+			glVertexAttribPointer(3, 2, GL_SHORT, GL_TRUE, (GLsizei)stride, (void*)offsetof(CompactTangentVertex, Tangent));
+		}
+	}
+
+	// rebuilds the CPU copy residency asks for from the GPU layout; compact vertices come back as
+	// the vertex shader decodes them
+	void unpack(const PackedGeometry &geometry, CpuResidency residency)
+	{
+		indices.resize(geometry.indexCount);
+		for (size_t i = 0; i < indices.size(); i++)
+		{
+			indices[i] = geometry.indexType == GL_UNSIGNED_SHORT ? ((const unsigned short*)geometry.indexData)[i]
+				: ((const unsigned int*)geometry.indexData)[i];
+		}
+
+		const unsigned char *data = (const unsigned char*)geometry.vertexData;
+		size_t stride = VertexStride(format, hasTangents);
+		if (residency == CPU_RESIDENCY_KEEP)
+		{
+			vertices.resize(geometry.vertexCount);
+			for (size_t i = 0; i < vertices.size(); i++)
+				vertices[i] = unpackVertex(data + i * stride);
+		}
+		else
+		{
+			positions.resize(geometry.vertexCount);
+			for (size_t i = 0; i < positions.size(); i++)
+				positions[i] = unpackVertex(data + i * stride).Position;
+		}
+	}
+
+	Vertex unpackVertex(const unsigned char *data) const
+	{
+		Vertex vertex = {};
+		if (format == VERTEX_FORMAT_FULL)
+		{
+			memcpy(&vertex, data, sizeof(Vertex));
+			return vertex;
+		}
+
+		CompactTangentVertex compact = {};
+		memcpy(&compact, data, VertexStride(format, hasTangents));
+		vertex.Position = positionOffset + positionScale * glm::vec3(UnpackSnorm16(compact.Position[0]), UnpackSnorm16(compact.Position[1]), UnpackSnorm16(compact.Position[2]));
+		vertex.Normal = OctDecode(glm::vec2(UnpackSnorm16(compact.Normal[0]), UnpackSnorm16(compact.Normal[1])));
+		vertex.TexCoords = glm::vec2(glm::unpackHalf1x16(compact.TexCoords[0]), glm::unpackHalf1x16(compact.TexCoords[1]));
+		if (hasTangents)
+		{
+			vertex.Tangent = OctDecode(glm::vec2(UnpackSnorm16(compact.Tangent[0]), UnpackSnorm16(compact.Tangent[1])));
+			vertex.Bitangent = glm::cross(vertex.Normal, vertex.Tangent) * UnpackSnorm16(compact.Position[3]);
+		}
+		return vertex;
 	}
 };
 #endif
\ No newline at end of file
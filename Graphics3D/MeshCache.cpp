@@ -0,0 +1,216 @@
+#include "MeshCache.h"
+#include "Hash.h"
+#include "StringPool.h"
+#include "CpuProfiler.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+static uint64_t alignTo(uint64_t offset, uint64_t alignment)
+{
+	return (offset + alignment - 1) / alignment * alignment;
+}
+
+static uint64_t indexSize(uint32_t indexType)
+{
+	return indexType == GL_UNSIGNED_SHORT ? sizeof(unsigned short) : sizeof(unsigned int);
+}
+
+std::string MeshCache::PathFor(const std::string &sourcePath)
+{
+	return sourcePath + ".g3dcache";
+}
+
+bool MeshCache::ComputeKey(const std::string &sourcePath, unsigned int importFlags, uint64_t optionsHash, uint64_t &key)
+{
+	// note: only the model file itself is hashed, so edits to a referenced .mtl
+	// need the cache file to be deleted by hand
+	key = FNV_OFFSET_BASIS;
+	if (!HashFile(sourcePath, key))
+		return false;
+	key = HashValue(importFlags, key);
+	key = HashValue(optionsHash, key);
+	key = HashValue(MESH_CACHE_VERSION, key);
+	key = HashValue((uint32_t)sizeof(Vertex), key);
+	return true;
+}
+
+bool MeshCache::Write(const std::string &cachePath, uint64_t key, const std::vector<Mesh> &meshes)
+{
+	PROFILE_FUNCTION();
+	// 1. pack the geometry as it was uploaded, and lay out the tables and the string data
+	std::vector<PackedGeometry> geometry(meshes.size());
+	std::vector<std::vector<unsigned char>> vertexScratch(meshes.size()), indexScratch(meshes.size());
+	std::vector<MeshCacheMesh> meshTable(meshes.size());
+	std::vector<MeshCacheTexture> textureTable;
+	std::string strings;
+	for (size_t i = 0; i < meshes.size(); i++)
+	{
+		const Mesh &mesh = meshes[i];
+		geometry[i] = Mesh::Pack(mesh.vertices.data(), mesh.vertices.size(), mesh.indices.data(), mesh.indices.size(), mesh.format, mesh.hasTangents, vertexScratch[i], indexScratch[i]);
+		meshTable[i].vertexCount = geometry[i].vertexCount;
+		meshTable[i].indexCount = geometry[i].indexCount;
+		meshTable[i].indexType = geometry[i].indexType;
+		meshTable[i].bounds = geometry[i].bounds;
+		meshTable[i].boundingSphere = geometry[i].boundingSphere;
+		meshTable[i].positionOffset = geometry[i].positionOffset;
+		meshTable[i].positionScale = geometry[i].positionScale;
+		meshTable[i].firstTexture = (uint32_t)textureTable.size();
+		meshTable[i].textureCount = (uint32_t)mesh.textures.size();
+		for (size_t j = 0; j < mesh.textures.size(); j++)
+		{
+			MeshCacheTexture texture;
+			const std::string &path = StringPool::Instance().Get(mesh.textures[j].path);
+			texture.pathOffset = (uint32_t)strings.size();
+			texture.pathLength = (uint32_t)path.size();
+			strings.append(path);
+			texture.type = mesh.textures[j].type;
+			texture.shininess = mesh.textures[j].shininess;
+			textureTable.push_back(texture);
+		}
+	}
+
+	// 2. place the vertex and index arrays after the tables
+	uint32_t vertexSize = meshes.empty() ? 0 : (uint32_t)Mesh::VertexStride(meshes[0].format, meshes[0].hasTangents);
+	uint64_t offset = sizeof(MeshCacheHeader) + meshTable.size() * sizeof(MeshCacheMesh)
+		+ textureTable.size() * sizeof(MeshCacheTexture) + strings.size();
+	for (size_t i = 0; i < meshTable.size(); i++)
+	{
+		offset = alignTo(offset, 16);
+		meshTable[i].vertexOffset = offset;
+		offset += (uint64_t)meshTable[i].vertexCount * vertexSize;
+		offset = alignTo(offset, 16);
+		meshTable[i].indexOffset = offset;
+		offset += (uint64_t)meshTable[i].indexCount * indexSize(meshTable[i].indexType);
+	}
+
+	MeshCacheHeader header;
+	header.magic = MESH_CACHE_MAGIC;
+	header.version = MESH_CACHE_VERSION;
+	header.key = key;
+	header.vertexSize = vertexSize;
+	header.meshCount = (uint32_t)meshTable.size();
+	header.textureCount = (uint32_t)textureTable.size();
+	header.stringBytes = (uint32_t)strings.size();
+
+	// 3. write to a temporary file and swap it in, so a crash never leaves a truncated cache behind
+	std::string tempPath = cachePath + ".tmp";
+	{
+		std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+		if (!out)
+			return false;
+
+		out.write((const char*)&header, sizeof(header));
+		if (!meshTable.empty())
+			out.write((const char*)&meshTable[0], meshTable.size() * sizeof(MeshCacheMesh));
+		if (!textureTable.empty())
+			out.write((const char*)&textureTable[0], textureTable.size() * sizeof(MeshCacheTexture));
+		out.write(strings.data(), strings.size());
+
+		const char zeros[16] = { 0 };
+		for (size_t i = 0; i < meshes.size(); i++)
+		{
+			out.write(zeros, meshTable[i].vertexOffset - (uint64_t)out.tellp());
+			out.write((const char*)geometry[i].vertexData, (uint64_t)meshTable[i].vertexCount * vertexSize);
+			out.write(zeros, meshTable[i].indexOffset - (uint64_t)out.tellp());
+			out.write((const char*)geometry[i].indexData, (uint64_t)meshTable[i].indexCount * indexSize(meshTable[i].indexType));
+		}
+		if (!out)
+		{
+			out.close();
+			std::remove(tempPath.c_str());
+			return false;
+		}
+	}
+	std::remove(cachePath.c_str());
+	return std::rename(tempPath.c_str(), cachePath.c_str()) == 0;
+}
+
+bool MeshCache::Open(const std::string &cachePath, uint64_t key, size_t vertexStride)
+{
+	PROFILE_FUNCTION();
+	if (!file.open(cachePath))
+		return false;
+
+	const unsigned char *data = file.data();
+	size_t size = file.size();
+	if (size < sizeof(MeshCacheHeader))
+		return false;
+
+	header = (const MeshCacheHeader*)data;
+	if (header->magic != MESH_CACHE_MAGIC || header->version != MESH_CACHE_VERSION
+		|| header->key != key || (header->meshCount > 0 && header->vertexSize != vertexStride))
+	{
+		file.close();
+		return false;
+	}
+
+	uint64_t tablesEnd = sizeof(MeshCacheHeader) + (uint64_t)header->meshCount * sizeof(MeshCacheMesh)
+		+ (uint64_t)header->textureCount * sizeof(MeshCacheTexture) + header->stringBytes;
+	if (tablesEnd > size)
+	{
+		file.close();
+		return false;
+	}
+	meshTable = (const MeshCacheMesh*)(data + sizeof(MeshCacheHeader));
+	textureTable = (const MeshCacheTexture*)(meshTable + header->meshCount);
+	strings = (const char*)(textureTable + header->textureCount);
+
+	// reject anything pointing outside of the mapping
+	for (uint32_t i = 0; i < header->meshCount; i++)
+	{
+		const MeshCacheMesh &mesh = meshTable[i];
+		if ((mesh.indexType != GL_UNSIGNED_SHORT && mesh.indexType != GL_UNSIGNED_INT)
+			|| mesh.vertexOffset + (uint64_t)mesh.vertexCount * header->vertexSize > size
+			|| mesh.indexOffset + (uint64_t)mesh.indexCount * indexSize(mesh.indexType) > size
+			|| (uint64_t)mesh.firstTexture + mesh.textureCount > header->textureCount)
+		{
+			file.close();
+			return false;
+		}
+	}
+	for (uint32_t i = 0; i < header->textureCount; i++)
+	{
+		const MeshCacheTexture &texture = textureTable[i];
+		if ((uint64_t)texture.pathOffset + texture.pathLength > header->stringBytes
+			|| texture.type >= TEXTURE_TYPE_COUNT)
+		{
+			file.close();
+			return false;
+		}
+	}
+	return true;
+}
+
+PackedGeometry MeshCache::Geometry(unsigned int mesh) const
+{
+	const MeshCacheMesh &entry = meshTable[mesh];
+	PackedGeometry geometry;
+	geometry.vertexData = file.data() + entry.vertexOffset;
+	geometry.vertexCount = entry.vertexCount;
+	geometry.indexData = file.data() + entry.indexOffset;
+	geometry.indexCount = entry.indexCount;
+	geometry.indexType = entry.indexType;
+	geometry.bounds = entry.bounds;
+	geometry.boundingSphere = entry.boundingSphere;
+	geometry.positionOffset = entry.positionOffset;
+	geometry.positionScale = entry.positionScale;
+	return geometry;
+}
+
+std::string MeshCache::TexturePath(unsigned int mesh, unsigned int i) const
+{
+	const MeshCacheTexture &texture = textureTable[meshTable[mesh].firstTexture + i];
+	return std::string(strings + texture.pathOffset, texture.pathLength);
+}
+
+TextureType MeshCache::TextureTypeOf(unsigned int mesh, unsigned int i) const
+{
+	return (TextureType)textureTable[meshTable[mesh].firstTexture + i].type;
+}
+
+float MeshCache::TextureShininess(unsigned int mesh, unsigned int i) const
+{
+	return textureTable[meshTable[mesh].firstTexture + i].shininess;
+}
@@ -0,0 +1,87 @@
+#ifndef MESH_CACHE_H
+#define MESH_CACHE_H
+
+#include "Mesh.h"
+#include "MappedFile.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Baked binary form of an imported model: every mesh's geometry in the layout of its
+// GPU buffers (see PackedGeometry) plus the texture table, laid out so the arrays can
+// be mapped and handed straight to glBufferData.
+//
+// File layout (all offsets are from the start of the file):
+//   MeshCacheHeader
+//   MeshCacheMesh[meshCount]
+//   MeshCacheTexture[textureCount]
+//   string data (texture paths)
+//   vertex and index arrays, each 16-byte aligned
+const uint32_t MESH_CACHE_MAGIC = 0x4D443347; // "G3DM"
+const uint32_t MESH_CACHE_VERSION = 4;
+
+struct MeshCacheHeader {
+	uint32_t magic;
+	uint32_t version;
+	uint64_t key;
+	// stride of the stored vertex format
+	uint32_t vertexSize;
+	uint32_t meshCount;
+	uint32_t textureCount;
+	uint32_t stringBytes;
+};
+
+struct MeshCacheMesh {
+	uint64_t vertexOffset;
+	uint64_t indexOffset;
+	uint32_t vertexCount;
+	uint32_t indexCount;
+	// GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+	uint32_t indexType;
+	uint32_t firstTexture;
+	uint32_t textureCount;
+	AABB bounds;
+	BoundingSphere boundingSphere;
+	glm::vec3 positionOffset;
+	glm::vec3 positionScale;
+};
+
+struct MeshCacheTexture {
+	uint32_t pathOffset;
+	uint32_t pathLength;
+	uint32_t type; // TextureType
+	float shininess;
+};
+
+class MeshCache
+{
+	MappedFile file;
+	const MeshCacheHeader *header;
+	const MeshCacheMesh *meshTable;
+	const MeshCacheTexture *textureTable;
+	const char *strings;
+
+public:
+	MeshCache() : header(nullptr), meshTable(nullptr), textureTable(nullptr), strings(nullptr) { }
+
+	// cache file that sits next to the source model
+	static std::string PathFor(const std::string &sourcePath);
+	// key over the source file contents, the Assimp import flags, the model's own
+	// processing options (pre-hashed by the caller) and the cache layout
+	static bool ComputeKey(const std::string &sourcePath, unsigned int importFlags, uint64_t optionsHash, uint64_t &key);
+	// the meshes must still hold their CPU copy, which is packed again the way they were uploaded
+	static bool Write(const std::string &cachePath, uint64_t key, const std::vector<Mesh> &meshes);
+
+	// maps the cache and validates it against the expected key and vertex stride
+	bool Open(const std::string &cachePath, uint64_t key, size_t vertexStride);
+
+	unsigned int MeshCount() const { return header->meshCount; }
+	// points into the mapping, valid while the cache is open
+	PackedGeometry Geometry(unsigned int mesh) const;
+	unsigned int TextureCount(unsigned int mesh) const { return meshTable[mesh].textureCount; }
+	std::string TexturePath(unsigned int mesh, unsigned int i) const;
+	TextureType TextureTypeOf(unsigned int mesh, unsigned int i) const;
+	float TextureShininess(unsigned int mesh, unsigned int i) const;
+};
+#endif
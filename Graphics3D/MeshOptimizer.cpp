@@ -0,0 +1,318 @@
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <cmath>
+
+// cache size the triangle ordering is tuned for; larger than the simulated FIFO on purpose,
+// as recommended by Forsyth, so the result degrades gracefully on smaller caches
+const int OPTIMIZER_CACHE_SIZE = 32;
+const unsigned int NO_VERTEX = 0xFFFFFFFFu;
+
+VertexCacheStats AnalyzeVertexCache(const vector<unsigned int> &indices, size_t vertexCount, unsigned int cacheSize)
+{
+	VertexCacheStats stats;
+	stats.acmr = 0.0f;
+	stats.atvr = 0.0f;
+	if (indices.empty() || vertexCount == 0)
+		return stats;
+
+	// a vertex is in the FIFO if fewer than cacheSize misses happened since it was inserted
+	vector<unsigned int> insertedAt(vertexCount, 0);
+	unsigned int misses = 0;
+	for (size_t i = 0; i < indices.size(); i++)
+	{
+		unsigned int v = indices[i];
+		if (insertedAt[v] == 0 || misses - insertedAt[v] >= cacheSize)
+		{
+			misses++;
+			insertedAt[v] = misses;
+		}
+	}
+
+	stats.acmr = (float)misses / (float)(indices.size() / 3);
+	stats.atvr = (float)misses / (float)vertexCount;
+	return stats;
+}
+
+static float vertexScore(int cachePosition, unsigned int remainingValence)
+{
+	// vertices with no triangles left should never attract new ones
+	if (remainingValence == 0)
+		return -1.0f;
+
+	float score = 0.0f;
+	if (cachePosition >= 0)
+	{
+		// the last triangle's vertices get a fixed score so the next triangle doesn't just reuse an edge
+		if (cachePosition < 3)
+			score = 0.75f;
+		else
+			score = std::pow(1.0f - (cachePosition - 3) * (1.0f / (OPTIMIZER_CACHE_SIZE - 3)), 1.5f);
+	}
+	// favour vertices with few triangles left so they get finished off
+	score += 2.0f * std::pow((float)remainingValence, -0.5f);
+	return score;
+}
+
+void OptimizeVertexCache(vector<unsigned int> &indices, size_t vertexCount)
+{
+	size_t triangleCount = indices.size() / 3;
+	if (triangleCount == 0)
+		return;
+
+	// triangles adjacent to each vertex; the first remaining[v] entries are the ones not yet emitted
+	vector<unsigned int> remaining(vertexCount, 0);
+	for (size_t i = 0; i < indices.size(); i++)
+		remaining[indices[i]]++;
+	vector<unsigned int> offsets(vertexCount + 1, 0);
+	for (size_t v = 0; v < vertexCount; v++)
+		offsets[v + 1] = offsets[v] + remaining[v];
+	vector<unsigned int> adjacency(indices.size());
+	vector<unsigned int> fill(offsets.begin(), offsets.end() - 1);
+	for (size_t i = 0; i < indices.size(); i++)
+		adjacency[fill[indices[i]]++] = (unsigned int)(i / 3);
+
+	vector<int> cachePosition(vertexCount, -1);
+	vector<float> scores(vertexCount);
+	for (size_t v = 0; v < vertexCount; v++)
+		scores[v] = vertexScore(-1, remaining[v]);
+	vector<float> triangleScores(triangleCount);
+	for (size_t t = 0; t < triangleCount; t++)
+		triangleScores[t] = scores[indices[t * 3]] + scores[indices[t * 3 + 1]] + scores[indices[t * 3 + 2]];
+
+	vector<char> emitted(triangleCount, 0);
+	vector<unsigned int> result;
+	result.reserve(indices.size());
+	vector<unsigned int> cache, newCache;
+	cache.reserve(OPTIMIZER_CACHE_SIZE + 3);
+	newCache.reserve(OPTIMIZER_CACHE_SIZE + 3);
+
+	size_t scanCursor = 0;
+	int best = -1;
+	while (result.size() < indices.size())
+	{
+		// nothing in the cache is connected to a remaining triangle: continue in input order
+		if (best < 0)
+		{
+			while (emitted[scanCursor])
+				scanCursor++;
+			best = (int)scanCursor;
+		}
+
+		// emit the triangle and unlink it from its vertices
+		emitted[best] = 1;
+		const unsigned int *triangle = &indices[best * 3];
+		for (int k = 0; k < 3; k++)
+		{
+			unsigned int v = triangle[k];
+			result.push_back(v);
+
+			unsigned int *list = &adjacency[offsets[v]];
+			for (unsigned int j = 0; j < remaining[v]; j++)
+			{
+				if (list[j] == (unsigned int)best)
+				{
+					std::swap(list[j], list[remaining[v] - 1]);
+					break;
+				}
+			}
+			remaining[v]--;
+		}
+
+		// the triangle's vertices move to the front of the LRU cache
+		newCache.assign(triangle, triangle + 3);
+		for (size_t j = 0; j < cache.size(); j++)
+		{
+			unsigned int v = cache[j];
+			if (v != triangle[0] && v != triangle[1] && v != triangle[2])
+				newCache.push_back(v);
+		}
+		cache.swap(newCache);
+
+		// rescore everything that was or is in the cache and pick the best triangle touching it
+		for (size_t j = 0; j < cache.size(); j++)
+		{
+			unsigned int v = cache[j];
+			cachePosition[v] = j < (size_t)OPTIMIZER_CACHE_SIZE ? (int)j : -1;
+			scores[v] = vertexScore(cachePosition[v], remaining[v]);
+		}
+
+		best = -1;
+		float bestScore = -1.0f;
+		for (size_t j = 0; j < cache.size(); j++)
+		{
+			unsigned int v = cache[j];
+			const unsigned int *list = &adjacency[offsets[v]];
+			for (unsigned int k = 0; k < remaining[v]; k++)
+			{
+				unsigned int t = list[k];
+				triangleScores[t] = scores[indices[t * 3]] + scores[indices[t * 3 + 1]] + scores[indices[t * 3 + 2]];
+				if (triangleScores[t] > bestScore)
+				{
+					bestScore = triangleScores[t];
+					best = (int)t;
+				}
+			}
+		}
+
+		if (cache.size() > (size_t)OPTIMIZER_CACHE_SIZE)
+			cache.resize(OPTIMIZER_CACHE_SIZE);
+	}
+
+	indices.swap(result);
+}
+
+void OptimizeOverdraw(vector<unsigned int> &indices, const vector<Vertex> &vertices)
+{
+	size_t triangleCount = indices.size() / 3;
+	if (triangleCount == 0)
+		return;
+
+	// 1. split into clusters where the cache-optimized order restarts (all three vertices miss),
+	//    so reordering clusters barely changes the cache hit rate
+	vector<size_t> clusterStarts;
+	vector<unsigned int> insertedAt(vertices.size(), 0);
+	unsigned int misses = 0;
+	for (size_t t = 0; t < triangleCount; t++)
+	{
+		unsigned int triangleMisses = 0;
+		for (int k = 0; k < 3; k++)
+		{
+			unsigned int v = indices[t * 3 + k];
+			if (insertedAt[v] == 0 || misses - insertedAt[v] >= VERTEX_CACHE_SIZE)
+			{
+				misses++;
+				triangleMisses++;
+				insertedAt[v] = misses;
+			}
+		}
+		if (t == 0 || triangleMisses == 3)
+			clusterStarts.push_back(t);
+	}
+	clusterStarts.push_back(triangleCount);
+
+	// 2. area-weighted centroid of the whole mesh
+	glm::vec3 meshCentroid(0.0f);
+	float meshArea = 0.0f;
+	vector<glm::vec3> triangleCentroids(triangleCount);
+	vector<glm::vec3> triangleNormals(triangleCount);
+	for (size_t t = 0; t < triangleCount; t++)
+	{
+		const glm::vec3 &a = vertices[indices[t * 3]].Position;
+		const glm::vec3 &b = vertices[indices[t * 3 + 1]].Position;
+		const glm::vec3 &c = vertices[indices[t * 3 + 2]].Position;
+		triangleCentroids[t] = (a + b + c) / 3.0f;
+		triangleNormals[t] = glm::cross(b - a, c - a); // length is twice the area
+		float area = glm::length(triangleNormals[t]);
+		meshCentroid += triangleCentroids[t] * area;
+		meshArea += area;
+	}
+	if (meshArea > 0.0f)
+		meshCentroid /= meshArea;
+
+	// 3. clusters facing away from the centre are drawn first: they are the ones most likely
+	//    to cover the rest of the mesh
+	struct Cluster {
+		size_t start, end;
+		float sortKey;
+	};
+	vector<Cluster> clusters(clusterStarts.size() - 1);
+	for (size_t i = 0; i < clusters.size(); i++)
+	{
+		Cluster &cluster = clusters[i];
+		cluster.start = clusterStarts[i];
+		cluster.end = clusterStarts[i + 1];
+
+		glm::vec3 centroid(0.0f), normal(0.0f);
+		float area = 0.0f;
+		for (size_t t = cluster.start; t < cluster.end; t++)
+		{
+			float triangleArea = glm::length(triangleNormals[t]);
+			centroid += triangleCentroids[t] * triangleArea;
+			normal += triangleNormals[t];
+			area += triangleArea;
+		}
+		if (area > 0.0f)
+			centroid /= area;
+		float normalLength = glm::length(normal);
+		cluster.sortKey = normalLength > 0.0f ? glm::dot(centroid - meshCentroid, normal / normalLength) : 0.0f;
+	}
+	std::stable_sort(clusters.begin(), clusters.end(), [](const Cluster &a, const Cluster &b) { return a.sortKey > b.sortKey; });
+
+	vector<unsigned int> result;
+	result.reserve(indices.size());
+	for (size_t i = 0; i < clusters.size(); i++)
+		result.insert(result.end(), indices.begin() + clusters[i].start * 3, indices.begin() + clusters[i].end * 3);
+	indices.swap(result);
+}
+
+void OptimizeVertexFetch(vector<Vertex> &vertices, vector<unsigned int> &indices)
+{
+	vector<unsigned int> remap(vertices.size(), NO_VERTEX);
+	vector<Vertex> reordered;
+	reordered.reserve(vertices.size());
+	for (size_t i = 0; i < indices.size(); i++)
+	{
+		unsigned int &index = indices[i];
+		if (remap[index] == NO_VERTEX)
+		{
+			remap[index] = (unsigned int)reordered.size();
+			reordered.push_back(vertices[index]);
+		}
+		index = remap[index];
+	}
+	vertices.swap(reordered);
+}
+
+bool SplitForShortIndices(const vector<Vertex> &vertices, const vector<unsigned int> &indices, size_t vertexStride, vector<MeshPart> &parts)
+{
+	parts.clear();
+	if (vertices.size() <= MAX_SHORT_INDEX_VERTICES)
+		return false;
+
+	// walk the triangles in order and start a new part whenever the next one would not fit;
+	// partOf/remap record which part last used a vertex and its index there
+	vector<unsigned int> partOf(vertices.size(), NO_VERTEX);
+	vector<unsigned int> remap(vertices.size());
+	size_t totalVertices = 0;
+	for (size_t t = 0; t < indices.size() / 3; t++)
+	{
+		const unsigned int *triangle = &indices[t * 3];
+		unsigned int part = parts.empty() ? NO_VERTEX : (unsigned int)parts.size() - 1;
+
+		size_t newVertices = 0;
+		for (int k = 0; k < 3; k++)
+		{
+			if (part == NO_VERTEX || partOf[triangle[k]] != part)
+				newVertices++;
+		}
+		if (part == NO_VERTEX || parts[part].vertices.size() + newVertices > MAX_SHORT_INDEX_VERTICES)
+		{
+			parts.push_back(MeshPart());
+			part = (unsigned int)parts.size() - 1;
+		}
+
+		MeshPart &current = parts[part];
+		for (int k = 0; k < 3; k++)
+		{
+			unsigned int v = triangle[k];
+			if (partOf[v] != part)
+			{
+				partOf[v] = part;
+				remap[v] = (unsigned int)current.vertices.size();
+				current.vertices.push_back(vertices[v]);
+				totalVertices++;
+			}
+			current.indices.push_back(remap[v]);
+		}
+	}
+
+	size_t wholeBytes = vertices.size() * vertexStride + indices.size() * sizeof(unsigned int);
+	size_t splitBytes = totalVertices * vertexStride + indices.size() * sizeof(unsigned short);
+	if (splitBytes >= wholeBytes)
+	{
+		parts.clear();
+		return false;
+	}
+	return true;
+}
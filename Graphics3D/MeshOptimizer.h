@@ -0,0 +1,46 @@
+#ifndef MESH_OPTIMIZER_H
+#define MESH_OPTIMIZER_H
+
+#include "Mesh.h"
+
+#include <vector>
+
+// size of the simulated FIFO post-transform cache used for the statistics
+const unsigned int VERTEX_CACHE_SIZE = 16;
+
+struct VertexCacheStats {
+	// average cache misses per triangle (0.5 is ideal for a regular grid, 3 is worst)
+	float acmr;
+	// average transforms per vertex (1.0 is ideal)
+	float atvr;
+};
+
+// Simulates a FIFO post-transform cache over the index buffer
+VertexCacheStats AnalyzeVertexCache(const vector<unsigned int> &indices, size_t vertexCount, unsigned int cacheSize = VERTEX_CACHE_SIZE);
+
+// Reorders triangles for post-transform cache locality (Forsyth, "Linear-Speed Vertex Cache Optimisation")
+void OptimizeVertexCache(vector<unsigned int> &indices, size_t vertexCount);
+
+// Reorders clusters of the cache-optimized triangle list so outward-facing clusters are drawn
+// first and hide the rest of the mesh; the order inside each cluster is kept, so vertex reuse
+// only suffers at the cluster boundaries
+void OptimizeOverdraw(vector<unsigned int> &indices, const vector<Vertex> &vertices);
+
+// Renumbers vertices in the order the index buffer first uses them, so vertex fetch walks the
+// buffer sequentially; unreferenced vertices are dropped
+void OptimizeVertexFetch(vector<Vertex> &vertices, vector<unsigned int> &indices);
+
+// largest vertex count whose indices fit into GL_UNSIGNED_SHORT
+const size_t MAX_SHORT_INDEX_VERTICES = 65536;
+
+struct MeshPart {
+	vector<Vertex> vertices;
+	vector<unsigned int> indices;
+};
+
+// Splits a mesh into consecutive triangle ranges of at most MAX_SHORT_INDEX_VERTICES vertices each,
+// duplicating the vertices shared across a boundary. Returns false (and leaves parts empty) when the
+// mesh already fits or when the duplicated vertices would cost more than the 16-bit indices save,
+// given the size of one vertex on the GPU.
+bool SplitForShortIndices(const vector<Vertex> &vertices, const vector<unsigned int> &indices, size_t vertexStride, vector<MeshPart> &parts);
+#endif
@@ -0,0 +1,181 @@
+#ifndef MESH_WELDER_H
+#define MESH_WELDER_H
+
+#include "Mesh.h"
+#include "Hash.h"
+
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+
+// How duplicate vertices are merged on import
+enum WeldMode {
+	WELD_NONE,
+	// merge vertices whose attributes are equal
+	WELD_EXACT,
+	// merge vertices whose attributes each lie within epsilon (Euclidean distance) of a kept vertex
+	WELD_EPSILON
+};
+
+// the attributes that decide whether two vertices are the same: position, normal, uv and, when the
+// mesh has a tangent frame, tangent and bitangent
+struct WeldKey {
+	uint32_t values[14];
+
+	bool operator==(const WeldKey &other) const
+	{
+		return memcmp(values, other.values, sizeof(values)) == 0;
+	}
+};
+
+struct WeldKeyHash {
+	size_t operator()(const WeldKey &key) const
+	{
+		return (size_t)HashBytes(key.values, sizeof(key.values));
+	}
+};
+
+// epsilon-sized grid cell of a position, for WELD_EPSILON to find candidates by
+struct WeldCell {
+	int64_t x, y, z;
+
+	bool operator==(const WeldCell &other) const
+	{
+		return x == other.x && y == other.y && z == other.z;
+	}
+};
+
+struct WeldCellHash {
+	size_t operator()(const WeldCell &cell) const
+	{
+		return (size_t)HashValue(cell.z, HashValue(cell.y, HashValue(cell.x)));
+	}
+};
+
+inline WeldKey MakeWeldKey(const Vertex &vertex, bool tangents)
+{
+	const float attributes[14] = {
+		vertex.Position.x, vertex.Position.y, vertex.Position.z,
+		vertex.Normal.x, vertex.Normal.y, vertex.Normal.z,
+		vertex.TexCoords.x, vertex.TexCoords.y,
+		vertex.Tangent.x, vertex.Tangent.y, vertex.Tangent.z,
+		vertex.Bitangent.x, vertex.Bitangent.y, vertex.Bitangent.z
+	};
+
+	WeldKey key;
+	for (int i = 0; i < 14; i++)
+	{
+		// compare by value, so -0.0 and 0.0 must share a bit pattern
+		float value = i < 8 || tangents ? attributes[i] + 0.0f : 0.0f;
+		memcpy(&key.values[i], &value, sizeof(value));
+	}
+	return key;
+}
+
+inline WeldCell MakeWeldCell(const glm::vec3 &position, float epsilon)
+{
+	WeldCell cell;
+	cell.x = (int64_t)std::floor(position.x / epsilon);
+	cell.y = (int64_t)std::floor(position.y / epsilon);
+	cell.z = (int64_t)std::floor(position.z / epsilon);
+	return cell;
+}
+
+inline bool WithinWeldTolerance(const Vertex &a, const Vertex &b, float epsilon, bool tangents)
+{
+	float epsilonSquared = epsilon * epsilon;
+	glm::vec3 position = a.Position - b.Position;
+	glm::vec3 normal = a.Normal - b.Normal;
+	glm::vec2 texCoords = a.TexCoords - b.TexCoords;
+	if (glm::dot(position, position) > epsilonSquared || glm::dot(normal, normal) > epsilonSquared
+		|| glm::dot(texCoords, texCoords) > epsilonSquared)
+		return false;
+	if (!tangents)
+		return true;
+	glm::vec3 tangent = a.Tangent - b.Tangent;
+	glm::vec3 bitangent = a.Bitangent - b.Bitangent;
+	return glm::dot(tangent, tangent) <= epsilonSquared && glm::dot(bitangent, bitangent) <= epsilonSquared;
+}
+
+// Merges duplicate vertices and rewrites the index buffer to match. The first vertex of
+// every group is kept, so vertex order is otherwise preserved. With WELD_EPSILON a vertex
+// joins the earliest kept vertex within tolerance, found among the kept vertices in its
+// own and the 26 neighbouring position cells; the tangent frame only counts when tangents
+// is set, as it is left zero otherwise.
+inline void WeldVertices(vector<Vertex> &vertices, vector<unsigned int> &indices, WeldMode mode, float epsilon = 1e-5f, bool tangents = false)
+{
+	if (mode == WELD_NONE || vertices.empty())
+		return;
+
+	vector<unsigned int> remap(vertices.size());
+	vector<Vertex> welded;
+	welded.reserve(vertices.size());
+
+	if (mode == WELD_EXACT)
+	{
+		unordered_map<WeldKey, unsigned int, WeldKeyHash> unique;
+		unique.reserve(vertices.size());
+		for (size_t i = 0; i < vertices.size(); i++)
+		{
+			WeldKey key = MakeWeldKey(vertices[i], tangents);
+			unordered_map<WeldKey, unsigned int, WeldKeyHash>::iterator found = unique.find(key);
+			if (found != unique.end())
+				remap[i] = found->second;
+			else
+			{
+				remap[i] = (unsigned int)welded.size();
+				unique.emplace(key, remap[i]);
+				welded.push_back(vertices[i]);
+			}
+		}
+	}
+	else
+	{
+		// per cell the last kept vertex in it, chained through next to the earlier ones
+		const unsigned int NO_VERTEX = ~0u;
+		unordered_map<WeldCell, unsigned int, WeldCellHash> cells;
+		cells.reserve(vertices.size());
+		vector<unsigned int> next;
+		next.reserve(vertices.size());
+		for (size_t i = 0; i < vertices.size(); i++)
+		{
+			WeldCell cell = MakeWeldCell(vertices[i].Position, epsilon);
+			unsigned int match = NO_VERTEX;
+			for (int64_t z = cell.z - 1; z <= cell.z + 1; z++)
+			{
+				for (int64_t y = cell.y - 1; y <= cell.y + 1; y++)
+				{
+					for (int64_t x = cell.x - 1; x <= cell.x + 1; x++)
+					{
+						WeldCell neighbour = { x, y, z };
+						unordered_map<WeldCell, unsigned int, WeldCellHash>::iterator found = cells.find(neighbour);
+						if (found == cells.end())
+							continue;
+						for (unsigned int candidate = found->second; candidate != NO_VERTEX; candidate = next[candidate])
+						{
+							if (candidate < match && WithinWeldTolerance(vertices[i], welded[candidate], epsilon, tangents))
+								match = candidate;
+						}
+					}
+				}
+			}
+
+			if (match != NO_VERTEX)
+				remap[i] = match;
+			else
+			{
+				remap[i] = (unsigned int)welded.size();
+				unordered_map<WeldCell, unsigned int, WeldCellHash>::iterator head = cells.find(cell);
+				next.push_back(head != cells.end() ? head->second : NO_VERTEX);
+				cells[cell] = remap[i];
+				welded.push_back(vertices[i]);
+			}
+		}
+	}
+
+	for (size_t i = 0; i < indices.size(); i++)
+		indices[i] = remap[indices[i]];
+	vertices.swap(welded);
+}
+#endif
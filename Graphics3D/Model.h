@@ -7,51 +7,173 @@
 
 #include "Shader.h"
 #include "Mesh.h"
+#include "GLHandles.h"
+#include "MeshCache.h"
+#include "MeshWelder.h"
+#include "MeshOptimizer.h"
+#include "RenderQueue.h"
+#include "Hash.h"
+#include "StringPool.h"
+#include "TextureLoader.h"
+#include "TextureRegistry.h"
+#include "CpuProfiler.h"
 
 #include "assimp/Importer.hpp"
 #include "assimp/scene.h"
 #include "assimp/postprocess.h"
-#include "stb_image.h"
 
 #include <string>
 #include <fstream>
 #include <sstream>
 #include <iostream>
 #include <vector>
+#include <unordered_map>
 
-unsigned int TextureFromFile(const char *path, const string &directory);
+// post-processing applied on import; part of the mesh cache key
+const unsigned int MODEL_IMPORT_FLAGS = aiProcess_Triangulate | aiProcess_FlipUVs | aiProcess_GenNormals;
+
+// processing applied to every mesh after import; also part of the mesh cache key
+struct ModelOptions {
+	WeldMode weld = WELD_EXACT;
+	float weldEpsilon = 1e-5f;
+	// triangle order for post-transform cache reuse
+	bool optimizeVertexCache = true;
+	// cluster order for less overdraw; trades a little cache reuse
+	bool optimizeOverdraw = false;
+	// vertex order matching the index buffer
+	bool optimizeVertexFetch = true;
+	// GPU vertex layout, which the mesh cache stores as is; the CPU copy always holds full vertices
+	VertexFormat vertexFormat = VERTEX_FORMAT_COMPACT;
+	// import and upload a tangent frame, for normal mapping; none of the scene's shaders reads it yet
+	bool tangents = false;
+	// split meshes too big for 16-bit indices when that saves memory overall
+	bool splitForShortIndices = true;
+	// what the meshes keep on the CPU after upload; does not change what is baked, so not hashed
+	CpuResidency residency = CPU_RESIDENCY_KEEP;
+
+	unsigned int ImportFlags() const
+	{
+		return MODEL_IMPORT_FLAGS | (tangents ? aiProcess_CalcTangentSpace : 0);
+	}
+
+	uint64_t Hash() const
+	{
+		uint64_t hash = HashValue((int)weld);
+		hash = HashValue(weldEpsilon, hash);
+		hash = HashValue(optimizeVertexCache, hash);
+		hash = HashValue(optimizeOverdraw, hash);
+		hash = HashValue(optimizeVertexFetch, hash);
+		hash = HashValue((int)vertexFormat, hash);
+		hash = HashValue(tangents, hash);
+		hash = HashValue(splitForShortIndices, hash);
+		return hash;
+	}
+};
+
+// memory held by a model's geometry
+struct ModelMemory {
+	unsigned int meshes = 0;
+	// vertex and index arrays in system memory
+	size_t cpuBytes = 0;
+	// vertex, index and instance buffers
+	size_t gpuBytes = 0;
+};
 
 class Model
 {
-	vector<Texture> textures_loaded;
+	// one reference per distinct texture used by this model
+	unordered_map<unsigned int, TextureRef> textures_loaded;
+	TextureLoader textureLoader;
 
 	/* Model Data */
 	vector<Mesh> meshes;
+	// one Material per distinct texture set, shared by the meshes (and split parts) using it
+	unordered_map<uint64_t, shared_ptr<Material>> materials;
 	string directory;
+	ModelOptions options;
+
+	/* Instancing */
+	GLBuffer instanceVBO;
+	unsigned int instanceCount = 0;
+	// per mesh, the box around its bounds over all instances
+	vector<AABB> instanceBounds;
 
 	/* Functions */
 	void loadModel(string path)
 	{
+		PROFILE_FUNCTION();
+		directory = path.substr(0, path.find_last_of('/'));
+
+		// a baked cache that matches the source file skips Assimp entirely
+		string cachePath = MeshCache::PathFor(path);
+		uint64_t cacheKey;
+		bool hasKey = MeshCache::ComputeKey(path, options.ImportFlags(), options.Hash(), cacheKey);
+		if (hasKey && loadFromCache(cachePath, cacheKey))
+		{
+			// the meshes were built with the residency applied, straight from the mapped file
+			textureLoader.Finish(path);
+			return;
+		}
+
 		Assimp::Importer import;
 
-		const aiScene *scene = import.ReadFile(path, aiProcess_Triangulate | aiProcess_FlipUVs | aiProcess_GenNormals);
+		const aiScene *scene;
+		{
+			PROFILE_ZONE("Assimp::ReadFile");
+			scene = import.ReadFile(path, options.ImportFlags());
+		}
 		if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode)
 		{
 			cout << "ERROR::ASSIMP::" << import.GetErrorString() << endl;
 			return;
 		}
 
-		directory = path.substr(0, path.find_last_of('/'));
 		processNode(scene->mRootNode, scene);
+		textureLoader.Finish(path);
+
+		if (hasKey && !MeshCache::Write(cachePath, cacheKey, meshes))
+			cout << "ERROR::MESH_CACHE::FAILED_TO_WRITE " << cachePath << endl;
+		// only now: the cache is written from the CPU copy
+		applyResidency();
+	}
+
+	void applyResidency()
+	{
+		for (unsigned int i = 0; i < meshes.size(); i++)
+			meshes[i].ApplyResidency(options.residency);
+	}
+
+	bool loadFromCache(const string &cachePath, uint64_t cacheKey)
+	{
+		PROFILE_FUNCTION();
+		MeshCache cache;
+		if (!cache.Open(cachePath, cacheKey, Mesh::VertexStride(options.vertexFormat, options.tangents)))
+			return false;
+
+		meshes.reserve(cache.MeshCount());
+		for (unsigned int i = 0; i < cache.MeshCount(); i++)
+		{
+			vector<Texture> textures;
+			for (unsigned int j = 0; j < cache.TextureCount(i); j++)
+			{
+				Texture texture = loadTexture(cache.TexturePath(i, j), cache.TextureTypeOf(i, j));
+				texture.shininess = cache.TextureShininess(i, j);
+				textures.push_back(texture);
+			}
+			shared_ptr<Material> material = getMaterial(textures);
+			meshes.emplace_back(cache.Geometry(i), std::move(textures), options.vertexFormat, options.tangents, material, options.residency);
+		}
+		return true;
 	}
 
 	void processNode(aiNode *node, const aiScene *scene)
 	{
+		PROFILE_FUNCTION();
 		// process all the nodes meshes (if any)
 		for (unsigned int i = 0; i < node->mNumMeshes; i++)
 		{
 			aiMesh *mesh = scene->mMeshes[node->mMeshes[i]];
-			meshes.push_back(processMesh(mesh, scene));
+			processMesh(mesh, scene);
 		}
 		// then do the same for each of its children
 		for (unsigned int i = 0; i < node->mNumChildren; i++)
@@ -60,8 +182,9 @@ class Model
 		}
 	}
 
-	Mesh processMesh(aiMesh *mesh, const aiScene *scene)
+	void processMesh(aiMesh *mesh, const aiScene *scene)
 	{
+		PROFILE_FUNCTION();
 		vector<Vertex> vertices;
 		vector<unsigned int> indices;
 		vector<Texture> textures;
@@ -75,6 +198,18 @@ class Model
 			vector.z = mesh->mVertices[i].z;
 			vertex.Position = vector;
 
+			// keep tangents defined even when not requested so welding and the cache stay deterministic
+			if (options.tangents && mesh->mTangents && mesh->mBitangents)
+			{
+				vertex.Tangent = glm::vec3(mesh->mTangents[i].x, mesh->mTangents[i].y, mesh->mTangents[i].z);
+				vertex.Bitangent = glm::vec3(mesh->mBitangents[i].x, mesh->mBitangents[i].y, mesh->mBitangents[i].z);
+			}
+			else
+			{
+				vertex.Tangent = glm::vec3(0.0f);
+				vertex.Bitangent = glm::vec3(0.0f);
+			}
+
 			vector.x = mesh->mNormals[i].x;
 			vector.y = mesh->mNormals[i].y;
 			vector.z = mesh->mNormals[i].z;
@@ -102,6 +237,31 @@ class Model
 				indices.push_back(face.mIndices[j]);
 		}
 
+		// merge the duplicates Assimp leaves behind (one vertex per face corner for OBJ)
+		if (options.weld != WELD_NONE)
+		{
+			PROFILE_ZONE("weld");
+			size_t verticesBefore = vertices.size();
+			WeldVertices(vertices, indices, options.weld, options.weldEpsilon, options.tangents);
+			cout << "MESH::WELD::" << mesh->mName.C_Str() << " vertices " << verticesBefore << " -> " << vertices.size() << endl;
+		}
+
+		// reorder triangles and vertices for the GPU caches
+		if (options.optimizeVertexCache || options.optimizeOverdraw || options.optimizeVertexFetch)
+		{
+			PROFILE_ZONE("optimize");
+			VertexCacheStats before = AnalyzeVertexCache(indices, vertices.size());
+			if (options.optimizeVertexCache)
+				OptimizeVertexCache(indices, vertices.size());
+			if (options.optimizeOverdraw)
+				OptimizeOverdraw(indices, vertices);
+			if (options.optimizeVertexFetch)
+				OptimizeVertexFetch(vertices, indices);
+			VertexCacheStats after = AnalyzeVertexCache(indices, vertices.size());
+			cout << "MESH::VCACHE::" << mesh->mName.C_Str() << " ACMR " << before.acmr << " -> " << after.acmr
+				<< ", ATVR " << before.atvr << " -> " << after.atvr << endl;
+		}
+
 		// process material
 		if (mesh->mMaterialIndex >= 0)
 		{
@@ -115,13 +275,13 @@ class Model
 				shininess = 8;
 			}
 
-			vector<Texture> diffuseMaps = loadMaterialTextures(material, aiTextureType_DIFFUSE, "texture_diffuse");
+			vector<Texture> diffuseMaps = loadMaterialTextures(material, aiTextureType_DIFFUSE, TEXTURE_DIFFUSE);
 			for (size_t i = 0; i < diffuseMaps.size(); i++)
 			{
 				diffuseMaps[i].shininess = shininess;
 			}
 			textures.insert(textures.end(), diffuseMaps.begin(), diffuseMaps.end());
-			vector<Texture> specularMaps = loadMaterialTextures(material, aiTextureType_SPECULAR, "texture_specular");
+			vector<Texture> specularMaps = loadMaterialTextures(material, aiTextureType_SPECULAR, TEXTURE_SPECULAR);
 			for (size_t i = 0; i < specularMaps.size(); i++)
 			{
 				specularMaps[i].shininess = shininess;
@@ -129,95 +289,224 @@ class Model
 			textures.insert(textures.end(), specularMaps.begin(), specularMaps.end());
 		}
 
-		return Mesh(vertices, indices, textures);
+		shared_ptr<Material> material = getMaterial(textures);
+
+		// large meshes become several 16-bit indexed ones when the duplicated border vertices are cheaper
+		vector<MeshPart> parts;
+		if (options.splitForShortIndices
+			&& SplitForShortIndices(vertices, indices, Mesh::VertexStride(options.vertexFormat, options.tangents), parts))
+		{
+			cout << "MESH::SPLIT::" << mesh->mName.C_Str() << " " << vertices.size() << " vertices into " << parts.size() << " parts" << endl;
+			for (size_t i = 0; i < parts.size(); i++)
+				meshes.emplace_back(std::move(parts[i].vertices), std::move(parts[i].indices), textures, options.vertexFormat, options.tangents, material);
+			return;
+		}
+
+		meshes.emplace_back(std::move(vertices), std::move(indices), std::move(textures), options.vertexFormat, options.tangents, material);
+	}
+
+	shared_ptr<Material> getMaterial(const vector<Texture> &textures)
+	{
+		uint64_t key = FNV_OFFSET_BASIS;
+		for (size_t i = 0; i < textures.size(); i++)
+		{
+			key = HashValue(textures[i].id, key);
+			key = HashValue(textures[i].type, key);
+			key = HashValue(textures[i].shininess, key);
+		}
+		shared_ptr<Material> &material = materials[key];
+		if (!material)
+			material = make_shared<Material>(textures);
+		return material;
 	}
 
-	vector<Texture> loadMaterialTextures(aiMaterial *mat, aiTextureType type, string typeName)
+	vector<Texture> loadMaterialTextures(aiMaterial *mat, aiTextureType type, TextureType textureType)
 	{
 		vector<Texture> textures;
 		for (unsigned int i = 0; i < mat->GetTextureCount(type); i++)
 		{
 			aiString str;
 			mat->GetTexture(type, i, &str);
-			bool skip = false;
-			for (unsigned int j = 0; j < textures_loaded.size(); j++)
-			{
-				if (std::strcmp(textures_loaded[j].path.C_Str(), str.C_Str()) == 0)
-				{
-					textures.push_back(textures_loaded[j]);
-					skip = true;
-					break;
-				}
-			}
-			if (!skip)
-			{ // if texture hasnt been loaded already, load it
-				Texture texture;
-				texture.id = TextureFromFile(str.C_Str(), directory);
-				texture.type = typeName;
-				texture.path = str;
-				textures.push_back(texture);
-				textures_loaded.push_back(texture); // add to loaded textures
-			}
+			textures.push_back(loadTexture(str.C_Str(), textureType));
 		}
 		return textures;
 	}
 
+	Texture loadTexture(const string &path, TextureType type)
+	{
+		PROFILE_FUNCTION();
+		// the registry hands back the texture if any model has loaded it already, otherwise queues it
+		Texture texture;
+		texture.id = TextureRegistry::Instance().Acquire(directory + '/' + path, textureLoader);
+		texture.type = type;
+		texture.path = StringPool::Instance().Intern(path);
+		texture.shininess = 0.0f;
+		textures_loaded.emplace(texture.id, TextureRef(texture.id)); // a repeated reference is dropped again here
+		return texture;
+	}
+
 public:
 	float rotation;
 	glm::vec3 position;
 	/* Functions */
 	Model() { }
 
-	Model(const char *path)
+	Model(const char *path, const ModelOptions &options = ModelOptions())
 	{
+		this->options = options;
 		loadModel(path);
 		int i = 0;
 	}
 
-	void Draw(Shader shader)
+	// owns the GPU objects of its meshes: assigning another model releases them
+	Model(Model &&) = default;
+	Model &operator=(Model &&) = default;
+
+	ModelMemory Memory() const
 	{
+		ModelMemory memory;
+		memory.meshes = (unsigned int)meshes.size();
 		for (unsigned int i = 0; i < meshes.size(); i++)
-			meshes[i].Draw(shader);
+		{
+			memory.cpuBytes += meshes[i].CpuBytes();
+			memory.gpuBytes += meshes[i].GpuBytes();
+		}
+		memory.gpuBytes += instanceCount * sizeof(InstanceData);
+		return memory;
 	}
-};
 
-unsigned int TextureFromFile(const char *path, const string &directory)
-{
-	string filename = string(path);
-	filename = directory + '/' + filename;
+	// the permutation bits of the shader the meshes are drawn with (see Mesh::ShaderFeatures); all
+	// meshes of a model share the vertex format
+	unsigned int ShaderFeatures(bool instanced) const
+	{
+		return (instanced ? INSTANCED_FEATURE : 0) | (options.vertexFormat == VERTEX_FORMAT_COMPACT ? COMPACT_VERTEX_FEATURE : 0);
+	}
 
-	unsigned int textureID;
-	glGenTextures(1, &textureID);
+	// the shader must be the ShaderFeatures(false) variant here and in Draw and Submit below,
+	// the ShaderFeatures(true) one in the instanced functions
+	void Draw(Shader &shader)
+	{
+		MeshUniforms uniforms(shader);
+		for (unsigned int i = 0; i < meshes.size(); i++)
+			meshes[i].Draw(shader, uniforms);
+	}
 
-	int width, height, nrComponents;
-	unsigned char *data = stbi_load(filename.c_str(), &width, &height, &nrComponents, 0);
-	if (data)
+	// draws only the meshes whose world-space bounds intersect the frustum; modelMatrix must be
+	// the transform the shader's "model" uniform is set to
+	void Draw(Shader &shader, const glm::mat4 &modelMatrix, const Frustum &frustum, CullingStats &stats)
 	{
-		GLenum format;
-		if (nrComponents == 1)
-			format = GL_RED;
-		else if (nrComponents == 3)
-			format = GL_RGB;
-		else if (nrComponents == 4)
-			format = GL_RGBA;
+		MeshUniforms uniforms(shader);
+		for (unsigned int i = 0; i < meshes.size(); i++)
+		{
+			// cheap sphere rejection first, then the tighter box
+			if (!frustum.Intersects(TransformSphere(meshes[i].boundingSphere, modelMatrix))
+				|| !frustum.Intersects(TransformAABB(meshes[i].bounds, modelMatrix)))
+			{
+				stats.culled++;
+				continue;
+			}
+			stats.drawn++;
+			meshes[i].Draw(shader, uniforms);
+		}
+	}
 
-		glBindTexture(GL_TEXTURE_2D, textureID);
-		glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-		glGenerateMipmap(GL_TEXTURE_2D);
+	// queues the meshes that pass the frustum test instead of drawing them; see RenderQueue
+	void Submit(RenderQueue &queue, Shader &shader, const glm::mat4 &modelMatrix, const glm::mat3 &normalMatrix, const glm::vec3 &dirLightAmbient, const Frustum &frustum, CullingStats &stats)
+	{
+		for (unsigned int i = 0; i < meshes.size(); i++)
+		{
+			BoundingSphere sphere = TransformSphere(meshes[i].boundingSphere, modelMatrix);
+			if (!frustum.Intersects(sphere) || !frustum.Intersects(TransformAABB(meshes[i].bounds, modelMatrix)))
+			{
+				stats.culled++;
+				continue;
+			}
+			stats.drawn++;
+			queue.Submit(shader, meshes[i], modelMatrix, normalMatrix, dirLightAmbient, sphere);
+		}
+	}
 
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	// uploads one model matrix per instance for DrawInstanced; the normal matrices are derived here
+	// once instead of per frame
+	void SetInstances(const vector<glm::mat4> &transforms)
+	{
+		vector<InstanceData> instances(transforms.size());
+		for (size_t i = 0; i < transforms.size(); i++)
+		{
+			instances[i].Model = transforms[i];
+			instances[i].NormalMatrix = glm::transpose(glm::inverse(glm::mat3(transforms[i])));
+		}
 
-		stbi_image_free(data);
+		if (instanceVBO == 0)
+		{
+			instanceVBO = GLBuffer::Create();
+			for (unsigned int i = 0; i < meshes.size(); i++)
+				meshes[i].SetInstanceBuffer(instanceVBO);
+		}
+		glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+		glBufferData(GL_ARRAY_BUFFER, instances.size() * sizeof(InstanceData), instances.empty() ? NULL : &instances[0], GL_DYNAMIC_DRAW);
+		RenderStats::CountBufferUpload(instances.size() * sizeof(InstanceData));
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		instanceCount = (unsigned int)instances.size();
+
+		instanceBounds.resize(meshes.size());
+		for (unsigned int i = 0; i < meshes.size(); i++)
+		{
+			for (size_t j = 0; j < transforms.size(); j++)
+			{
+				AABB box = TransformAABB(meshes[i].bounds, transforms[j]);
+				instanceBounds[i].min = j == 0 ? box.min : glm::min(instanceBounds[i].min, box.min);
+				instanceBounds[i].max = j == 0 ? box.max : glm::max(instanceBounds[i].max, box.max);
+			}
+		}
 	}
-	else
+
+	// draws every mesh once for all instances given to SetInstances
+	void DrawInstanced(Shader &shader)
 	{
-		std::cout << "Texture failed to load at path: " << path << std::endl;
-		stbi_image_free(data);
+		if (instanceCount == 0)
+			return;
+		MeshUniforms uniforms(shader);
+		for (unsigned int i = 0; i < meshes.size(); i++)
+			meshes[i].DrawInstanced(shader, uniforms, instanceCount);
 	}
 
-	return textureID;
-}
+	// as above, skipping meshes that no instance brings into the frustum
+	void DrawInstanced(Shader &shader, const Frustum &frustum, CullingStats &stats)
+	{
+		if (instanceCount == 0)
+			return;
+		MeshUniforms uniforms(shader);
+		for (unsigned int i = 0; i < meshes.size(); i++)
+		{
+			if (!frustum.Intersects(instanceBounds[i]))
+			{
+				stats.culled++;
+				continue;
+			}
+			stats.drawn++;
+			meshes[i].DrawInstanced(shader, uniforms, instanceCount);
+		}
+	}
+
+	// queues one instanced draw per mesh that some instance brings into the frustum
+	void SubmitInstanced(RenderQueue &queue, Shader &shader, const glm::vec3 &dirLightAmbient, const Frustum &frustum, CullingStats &stats)
+	{
+		if (instanceCount == 0)
+			return;
+		for (unsigned int i = 0; i < meshes.size(); i++)
+		{
+			if (!frustum.Intersects(instanceBounds[i]))
+			{
+				stats.culled++;
+				continue;
+			}
+			stats.drawn++;
+			BoundingSphere sphere;
+			sphere.center = instanceBounds[i].Center();
+			sphere.radius = glm::length(instanceBounds[i].Extent());
+			queue.Submit(shader, meshes[i], glm::mat4(1.0f), glm::mat3(1.0f), dirLightAmbient, sphere, instanceCount);
+		}
+	}
+};
 #endif
\ No newline at end of file
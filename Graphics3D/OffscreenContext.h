@@ -0,0 +1,16 @@
+#ifndef OFFSCREEN_CONTEXT_H
+#define OFFSCREEN_CONTEXT_H
+
+// An OpenGL 3.3 core context with no window and no display server behind it: EGL on Mesa's
+// surfaceless platform, which also runs on the llvmpipe software rasterizer. Only built in when
+// G3D_EGL is defined (link with -lEGL); otherwise Create fails and main falls back to a hidden
+// GLFW window. Rendering has to go to a RenderTarget, as there is no default framebuffer.
+class OffscreenContext
+{
+public:
+	// creates the context, makes it current and loads the GL functions
+	static bool Create();
+	// releases the context; GL objects must be deleted before
+	static void Destroy();
+};
+#endif
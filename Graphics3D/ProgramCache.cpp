@@ -0,0 +1,112 @@
+#include "ProgramCache.h"
+#include "Hash.h"
+
+#include <cstdio>
+#include <fstream>
+
+bool ProgramCache::Supported()
+{
+	if (!GLAD_GL_VERSION_4_1)
+		return false;
+	GLint formats = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+	return formats > 0;
+}
+
+std::string ProgramCache::PathFor(const std::vector<std::string> &sourcePaths, const std::vector<std::string> &defines)
+{
+	uint64_t hash = FNV_OFFSET_BASIS;
+	for (size_t i = 0; i < sourcePaths.size(); i++)
+		hash = HashString(sourcePaths[i] + "\n", hash);
+	for (size_t i = 0; i < defines.size(); i++)
+		hash = HashString(defines[i] + "\n", hash);
+	char suffix[32];
+	std::snprintf(suffix, sizeof(suffix), ".%016llx.g3dprog", (unsigned long long)hash);
+	return sourcePaths[0] + suffix;
+}
+
+uint64_t ProgramCache::ComputeKey(const std::vector<std::string> &sources, const std::vector<std::string> &defines)
+{
+	// the sources are hashed after preprocessing, so edits to included files count as well
+	uint64_t key = FNV_OFFSET_BASIS;
+	for (size_t i = 0; i < sources.size(); i++)
+	{
+		key = HashValue((uint64_t)sources[i].size(), key);
+		key = HashString(sources[i], key);
+	}
+	for (size_t i = 0; i < defines.size(); i++)
+		key = HashString(defines[i] + "\n", key);
+	// binaries are only valid for the driver build that produced them
+	const GLenum driverStrings[] = { GL_VENDOR, GL_RENDERER, GL_VERSION };
+	for (size_t i = 0; i < 3; i++)
+	{
+		const char *value = (const char*)glGetString(driverStrings[i]);
+		key = HashString(value ? std::string(value) + "\n" : "\n", key);
+	}
+	key = HashValue(PROGRAM_CACHE_VERSION, key);
+	return key;
+}
+
+bool ProgramCache::Load(const std::string &cachePath, uint64_t key, GLuint program)
+{
+	std::ifstream in(cachePath, std::ios::binary);
+	if (!in)
+		return false;
+
+	ProgramCacheHeader header;
+	if (!in.read((char*)&header, sizeof(header)))
+		return false;
+	if (header.magic != PROGRAM_CACHE_MAGIC || header.version != PROGRAM_CACHE_VERSION
+		|| header.key != key || header.length == 0)
+		return false;
+
+	std::vector<char> binary(header.length);
+	if (!in.read(&binary[0], binary.size()))
+		return false;
+
+	// the driver may still refuse it (e.g. after an update that kept the version string)
+	glProgramBinary(program, header.format, &binary[0], (GLsizei)binary.size());
+	GLint success = 0;
+	glGetProgramiv(program, GL_LINK_STATUS, &success);
+	return success != 0;
+}
+
+bool ProgramCache::Write(const std::string &cachePath, uint64_t key, GLuint program)
+{
+	GLint length = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0)
+		return false;
+
+	std::vector<char> binary(length);
+	GLenum format = 0;
+	GLsizei written = 0;
+	glGetProgramBinary(program, length, &written, &format, &binary[0]);
+	if (written <= 0)
+		return false;
+
+	ProgramCacheHeader header;
+	header.magic = PROGRAM_CACHE_MAGIC;
+	header.version = PROGRAM_CACHE_VERSION;
+	header.key = key;
+	header.format = format;
+	header.length = (uint32_t)written;
+
+	// write to a temporary file and swap it in, so a crash never leaves a truncated cache behind
+	std::string tempPath = cachePath + ".tmp";
+	{
+		std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+		if (!out)
+			return false;
+		out.write((const char*)&header, sizeof(header));
+		out.write(&binary[0], written);
+		if (!out)
+		{
+			out.close();
+			std::remove(tempPath.c_str());
+			return false;
+		}
+	}
+	std::remove(cachePath.c_str());
+	return std::rename(tempPath.c_str(), cachePath.c_str()) == 0;
+}
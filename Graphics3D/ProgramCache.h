@@ -0,0 +1,44 @@
+#ifndef PROGRAM_CACHE_H
+#define PROGRAM_CACHE_H
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Linked program binaries (glGetProgramBinary, core since GL 4.1) kept on disk, so warm starts
+// skip compiling and linking. One file per program and permutation; the key stored in it covers
+// the preprocessed sources and the driver, and anything that doesn't match is rebuilt from source.
+//
+// File layout:
+//   ProgramCacheHeader
+//   binary[length]
+const uint32_t PROGRAM_CACHE_MAGIC = 0x50443347; // "G3DP"
+const uint32_t PROGRAM_CACHE_VERSION = 1;
+
+struct ProgramCacheHeader {
+	uint32_t magic;
+	uint32_t version;
+	uint64_t key;
+	uint32_t format;
+	uint32_t length;
+};
+
+class ProgramCache
+{
+public:
+	// needs GL 4.1 and at least one binary format; the context may be newer than the 3.3 asked for
+	static bool Supported();
+	// cache file for a program: next to its first source, suffixed with a hash of all the source
+	// paths and the defines
+	static std::string PathFor(const std::vector<std::string> &sourcePaths, const std::vector<std::string> &defines);
+	// key over the preprocessed sources of every stage, the defines and the GL vendor/renderer/version
+	static uint64_t ComputeKey(const std::vector<std::string> &sources, const std::vector<std::string> &defines);
+
+	// loads the binary into program and checks it links; false if missing, stale or rejected
+	static bool Load(const std::string &cachePath, uint64_t key, GLuint program);
+	// stores a linked program (created with GL_PROGRAM_BINARY_RETRIEVABLE_HINT)
+	static bool Write(const std::string &cachePath, uint64_t key, GLuint program);
+};
+#endif
@@ -0,0 +1,99 @@
+#include "RenderQueue.h"
+
+#include <algorithm>
+
+// sort key layout, most significant first
+const unsigned int PROGRAM_BITS = 8;
+const unsigned int MATERIAL_BITS = 24;
+const unsigned int DEPTH_BITS = 32;
+
+void RenderQueue::Begin(const glm::mat4 &view, float zNear, float zFar)
+{
+	this->view = view;
+	this->zNear = zNear;
+	this->zFar = zFar;
+	items.clear();
+	programIds.clear();
+	materialIds.clear();
+	stats = RenderQueueStats();
+}
+
+void RenderQueue::Submit(Shader &shader, Mesh &mesh, const glm::mat4 &model, const glm::mat3 &normalMatrix, const glm::vec3 &dirLightAmbient, const BoundingSphere &bounds, unsigned int instanceCount)
+{
+	uint32_t program = programIds.emplace(shader.ID, (uint32_t)programIds.size()).first->second;
+	uint32_t material = materialIds.emplace(mesh.material.get(), (uint32_t)materialIds.size()).first->second;
+
+	// distance of the nearest point of the bounds in front of the camera, as a fraction of the depth range
+	float depth = -glm::vec3(view * glm::vec4(bounds.center, 1.0f)).z - bounds.radius;
+	float range = glm::clamp((depth - zNear) / (zFar - zNear), 0.0f, 1.0f);
+	uint64_t quantized = (uint64_t)(range * (float)((1ull << DEPTH_BITS) - 1));
+
+	DrawItem item;
+	item.key = ((uint64_t)std::min(program, (1u << PROGRAM_BITS) - 1) << (MATERIAL_BITS + DEPTH_BITS))
+		| ((uint64_t)std::min(material, (1u << MATERIAL_BITS) - 1) << DEPTH_BITS)
+		| quantized;
+	item.shader = &shader;
+	item.mesh = &mesh;
+	item.model = model;
+	item.normalMatrix = normalMatrix;
+	item.dirLightAmbient = dirLightAmbient;
+	item.instanceCount = instanceCount;
+	items.push_back(item);
+}
+
+void RenderQueue::Flush()
+{
+	std::sort(items.begin(), items.end(), [](const DrawItem &a, const DrawItem &b) { return a.key < b.key; });
+
+	Shader *shader = nullptr;
+	bool materialBound = false;
+	uint32_t materialKey = 0;
+	Uniform modelUniform, normalMatrixUniform, dirLightAmbientUniform;
+	MeshUniforms meshUniforms;
+	// the mesh whose uniforms the current program holds, so consecutive items of a mesh (one material
+	// sorts together) set them once
+	const Mesh *uniformMesh = nullptr;
+	for (size_t i = 0; i < items.size(); i++)
+	{
+		const DrawItem &item = items[i];
+		if (item.shader != shader)
+		{
+			shader = item.shader;
+			shader->use();
+			stats.programSwitches++;
+			// handles belong to the program, resolve them once per switch
+			modelUniform = shader->uniform("model");
+			normalMatrixUniform = shader->uniform("normalMatrix");
+			dirLightAmbientUniform = shader->uniform("dirLightAmbient");
+			meshUniforms = MeshUniforms(*shader);
+			uniformMesh = nullptr;
+			materialBound = false;
+		}
+
+		// the material bits of the key identify the material within this frame
+		uint32_t itemMaterial = (uint32_t)(item.key >> DEPTH_BITS) & ((1u << MATERIAL_BITS) - 1);
+		if (!materialBound || itemMaterial != materialKey)
+		{
+			item.mesh->BindMaterial(*shader);
+			materialBound = true;
+			materialKey = itemMaterial;
+			stats.materialBinds++;
+		}
+
+		// instanced variants take the matrices from the instance buffer
+		if (item.instanceCount == 0)
+		{
+			shader->setMat4(modelUniform, item.model);
+			shader->setMat3(normalMatrixUniform, item.normalMatrix);
+		}
+		shader->setVec3(dirLightAmbientUniform, item.dirLightAmbient);
+		if (item.mesh != uniformMesh)
+		{
+			item.mesh->SetUniforms(*shader, meshUniforms);
+			uniformMesh = item.mesh;
+		}
+		item.mesh->DrawGeometry(item.instanceCount);
+		stats.draws++;
+	}
+	items.clear();
+}
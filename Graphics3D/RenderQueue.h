@@ -0,0 +1,57 @@
+#ifndef RENDER_QUEUE_H
+#define RENDER_QUEUE_H
+
+#include <glm/glm.hpp>
+
+#include "Mesh.h"
+#include "Shader.h"
+#include "Bounds.h"
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// one mesh draw waiting in the queue, with the per-object uniforms it sets
+struct DrawItem {
+	// program | material | depth, see RenderQueue::Flush
+	uint64_t key;
+	Shader *shader;
+	Mesh *mesh;
+	glm::mat4 model;
+	glm::mat3 normalMatrix;
+	// the ambient term of the directional light: the track is lit brighter than the props
+	glm::vec3 dirLightAmbient;
+	// 0 for a plain draw; otherwise the matrices come from the mesh's instance buffer
+	unsigned int instanceCount;
+};
+
+// per-flush counters
+struct RenderQueueStats {
+	unsigned int draws = 0;
+	unsigned int programSwitches = 0;
+	unsigned int materialBinds = 0;
+};
+
+// Collects the frame's mesh draws and issues them sorted by program, then texture set, then
+// front-to-back depth, so programs and textures are only bound when they change and near
+// geometry fills the depth buffer early. Items hold pointers: meshes and shaders must outlive Flush.
+class RenderQueue
+{
+	vector<DrawItem> items;
+	glm::mat4 view;
+	float zNear, zFar;
+	// dense ids for the programs and materials seen this frame
+	unordered_map<unsigned int, uint32_t> programIds;
+	unordered_map<const Material*, uint32_t> materialIds;
+	RenderQueueStats stats;
+public:
+	// starts a frame; the depth in the sort key is measured along the view direction
+	void Begin(const glm::mat4 &view, float zNear, float zFar);
+	// queues a draw; bounds is the world-space sphere of what will be drawn
+	void Submit(Shader &shader, Mesh &mesh, const glm::mat4 &model, const glm::mat3 &normalMatrix, const glm::vec3 &dirLightAmbient, const BoundingSphere &bounds, unsigned int instanceCount = 0);
+	// sorts and draws everything queued since Begin
+	void Flush();
+
+	const RenderQueueStats &Stats() const { return stats; }
+};
+#endif
@@ -0,0 +1,51 @@
+#include "RenderStats.h"
+
+static RenderCounters counters;
+static bool counting = true;
+
+void RenderStats::CountDraw(unsigned int indexCount, unsigned int instanceCount)
+{
+	if (!counting)
+		return;
+	counters.drawCalls++;
+	counters.triangles += (uint64_t)(indexCount / 3) * instanceCount;
+}
+
+void RenderStats::CountProgramSwitch()
+{
+	if (counting)
+		counters.programSwitches++;
+}
+
+void RenderStats::CountTextureBind()
+{
+	if (counting)
+		counters.textureBinds++;
+}
+
+void RenderStats::CountUniformUpload()
+{
+	if (counting)
+		counters.uniformUploads++;
+}
+
+void RenderStats::CountBufferUpload(size_t bytes)
+{
+	if (counting)
+		counters.bufferBytes += bytes;
+}
+
+void RenderStats::SetCounting(bool counting)
+{
+	::counting = counting;
+}
+
+const RenderCounters &RenderStats::Frame()
+{
+	return counters;
+}
+
+void RenderStats::ResetFrame()
+{
+	counters = RenderCounters();
+}
@@ -0,0 +1,36 @@
+#ifndef RENDER_STATS_H
+#define RENDER_STATS_H
+
+#include <cstddef>
+#include <cstdint>
+
+// what one frame asked of GL
+struct RenderCounters {
+	unsigned int drawCalls = 0;
+	uint64_t triangles = 0;
+	unsigned int programSwitches = 0;
+	unsigned int textureBinds = 0;
+	unsigned int uniformUploads = 0;
+	uint64_t bufferBytes = 0;
+};
+
+// Per-frame render counters. Draws and buffer uploads are reported where they are issued (Mesh,
+// Model, UniformBuffer, ClusteredLights, main); program switches, texture binds and uniform uploads
+// by GLState, so calls its cache filters out are not counted.
+class RenderStats
+{
+public:
+	// a triangle list draw of indexCount vertices, instanceCount times
+	static void CountDraw(unsigned int indexCount, unsigned int instanceCount = 1);
+	static void CountProgramSwitch();
+	static void CountTextureBind();
+	static void CountUniformUpload();
+	static void CountBufferUpload(size_t bytes);
+
+	// off while the overlay draws itself, so it does not show up in its own numbers
+	static void SetCounting(bool counting);
+
+	static const RenderCounters &Frame();
+	static void ResetFrame();
+};
+#endif
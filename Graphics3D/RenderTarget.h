@@ -0,0 +1,27 @@
+#ifndef RENDER_TARGET_H
+#define RENDER_TARGET_H
+
+#include <glad/glad.h>
+
+#include "GLHandles.h"
+
+#include <vector>
+
+// A framebuffer with an RGBA8 color and a 24-bit depth renderbuffer, rendered to in place of a
+// window (see the headless mode in main.cpp)
+class RenderTarget
+{
+	GLFramebuffer framebuffer;
+	GLRenderbuffer color, depth;
+
+public:
+	unsigned int width, height;
+
+	RenderTarget(unsigned int width, unsigned int height);
+	bool IsComplete() const;
+	// makes it the draw and read framebuffer and sets the viewport to its size
+	void Bind() const;
+	// the color buffer, bottom row first, 4 bytes per pixel; the target must be bound
+	void ReadPixels(std::vector<unsigned char> &pixels) const;
+};
+#endif
@@ -1,50 +1,157 @@
 #include "Shader.h"
+#include "ProgramCache.h"
+#include "GLState.h"
+#include "CpuProfiler.h"
+
+#include <cstring>
+#include <vector>
+
+// locations above this are not value-cached; drivers hand them out densely from 0
+const GLint MAX_CACHED_LOCATION = 4096;
+
+// bytes the setters pass for a uniform of this type; 0 for types they have no setter for
+static size_t uniformValueSize(GLenum type)
+{
+	switch (type)
+	{
+	case GL_FLOAT: return sizeof(float);
+	case GL_FLOAT_VEC2: return 2 * sizeof(float);
+	case GL_FLOAT_VEC3: return 3 * sizeof(float);
+	case GL_FLOAT_VEC4: return 4 * sizeof(float);
+	case GL_FLOAT_MAT2: return 4 * sizeof(float);
+	case GL_FLOAT_MAT3: return 9 * sizeof(float);
+	case GL_FLOAT_MAT4: return 16 * sizeof(float);
+	case GL_INT:
+	case GL_BOOL:
+	case GL_SAMPLER_2D:
+	case GL_SAMPLER_BUFFER:
+	case GL_INT_SAMPLER_BUFFER:
+	case GL_UNSIGNED_INT_SAMPLER_BUFFER:
+		return sizeof(int);
+	default: return 0;
+	}
+}
 
 Shader::Shader(const char* vertexPath, const char* fragmentPath, const char* geometryPath)
 {
-	// 1. retrieve the vertex/fragment source code from filePath
-	std::string vertexCode;
-	std::string fragmentCode;
-	std::string geometryCode;
-	std::ifstream vShaderFile;
-	std::ifstream fShaderFile;
-	std::ifstream gShaderFile;
+	build(vertexPath, fragmentPath, geometryPath, std::vector<std::string>());
+}
+Shader::Shader(const char* vertexPath, const char* fragmentPath, const std::vector<std::string> &defines, const char* geometryPath)
+{
+	build(vertexPath, fragmentPath, geometryPath, defines);
+}
+std::string Shader::preprocess(const std::string &path, const std::vector<std::string> &defines, std::vector<std::string> &included)
+{
+	std::string code;
+	std::ifstream shaderFile;
 	// ensure ifstream objects can throw exceptions:
-	vShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-	fShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-	gShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
+	shaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
 	try
 	{
-		// open files
-		vShaderFile.open(vertexPath);
-		fShaderFile.open(fragmentPath);
-		std::stringstream vShaderStream, fShaderStream;
-		// read file's buffer contents into streams
-		vShaderStream << vShaderFile.rdbuf();
-		fShaderStream << fShaderFile.rdbuf();
-		// close file handlers
-		vShaderFile.close();
-		fShaderFile.close();
-		// convert stream into string
-		vertexCode = vShaderStream.str();
-		fragmentCode = fShaderStream.str();
-		// if geometry shader path is present, also load a geometry shader
-		if (geometryPath != nullptr)
+		shaderFile.open(path.c_str());
+		std::stringstream shaderStream;
+		shaderStream << shaderFile.rdbuf();
+		shaderFile.close();
+		code = shaderStream.str();
+	}
+	catch (std::ifstream::failure &e)
+	{
+		std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ: " << path << std::endl;
+		return std::string();
+	}
+
+	// every file gets its own source string number, so compile errors read "<file>:<line>"
+	// with <file> the index into included
+	size_t sourceNumber = included.size();
+	included.push_back(path);
+	std::string directory = path.substr(0, path.find_last_of("/\\") + 1);
+
+	std::stringstream output;
+	std::istringstream lines(code);
+	std::string line;
+	int lineNumber = 0;
+	while (std::getline(lines, line))
+	{
+		lineNumber++;
+		size_t start = line.find_first_not_of(" \t");
+		if (start != std::string::npos && line.compare(start, 8, "#include") == 0)
 		{
-			gShaderFile.open(geometryPath);
-			std::stringstream gShaderStream;
-			gShaderStream << gShaderFile.rdbuf();
-			gShaderFile.close();
-			geometryCode = gShaderStream.str();
+			size_t open = line.find('"', start);
+			size_t close = open == std::string::npos ? open : line.find('"', open + 1);
+			if (close == std::string::npos)
+			{
+				std::cout << "ERROR::SHADER::MALFORMED_INCLUDE: " << path << ":" << lineNumber << std::endl;
+				continue;
+			}
+			// each file is spliced in at most once, which also stops include cycles
+			std::string includePath = directory + line.substr(open + 1, close - open - 1);
+			bool seen = false;
+			for (size_t i = 0; i < included.size(); i++)
+				seen = seen || included[i] == includePath;
+			if (!seen)
+			{
+				output << "#line 1 " << included.size() << "\n";
+				output << preprocess(includePath, std::vector<std::string>(), included);
+				output << "#line " << lineNumber + 1 << " " << sourceNumber << "\n";
+			}
+			continue;
+		}
+
+		output << line << "\n";
+		// the permutation's defines must come after #version, which has to be the first statement
+		if (!defines.empty() && start != std::string::npos && line.compare(start, 8, "#version") == 0)
+		{
+			for (size_t i = 0; i < defines.size(); i++)
+				output << "#define " << defines[i] << "\n";
+			output << "#line " << lineNumber + 1 << " " << sourceNumber << "\n";
 		}
 	}
-	catch (std::ifstream::failure e)
+	return output.str();
+}
+void Shader::build(const char* vertexPath, const char* fragmentPath, const char* geometryPath, const std::vector<std::string> &defines)
+{
+	PROFILE_FUNCTION();
+	// 1. retrieve the vertex/fragment source code from filePath, with includes and defines resolved
+	std::vector<std::string> included;
+	std::string vertexCode = preprocess(vertexPath, defines, included);
+	included.clear();
+	std::string fragmentCode = preprocess(fragmentPath, defines, included);
+	std::string geometryCode;
+	// if geometry shader path is present, also load a geometry shader
+	if (geometryPath != nullptr)
 	{
-		std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << std::endl;
+		included.clear();
+		geometryCode = preprocess(geometryPath, defines, included);
 	}
+
+	// 2. reuse the program binary from the last run if sources, defines and driver are unchanged
+	ID = GLProgram::Create();
+	bool cacheBinary = ProgramCache::Supported();
+	std::string cachePath;
+	uint64_t cacheKey = 0;
+	if (cacheBinary)
+	{
+		std::vector<std::string> paths = { vertexPath, fragmentPath };
+		std::vector<std::string> sources = { vertexCode, fragmentCode };
+		if (geometryPath != nullptr)
+		{
+			paths.push_back(geometryPath);
+			sources.push_back(geometryCode);
+		}
+		cachePath = ProgramCache::PathFor(paths, defines);
+		cacheKey = ProgramCache::ComputeKey(sources, defines);
+		if (ProgramCache::Load(cachePath, cacheKey, ID))
+		{
+			reflectUniforms();
+			return;
+		}
+		glProgramParameteri(ID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	}
+
+	PROFILE_ZONE("compile and link");
 	const char* vShaderCode = vertexCode.c_str();
 	const char * fShaderCode = fragmentCode.c_str();
-	// 2. compile shaders
+	// 3. compile shaders
 	unsigned int vertex, fragment;
 	// vertex shader
 	vertex = glCreateShader(GL_VERTEX_SHADER);
@@ -67,13 +174,20 @@ Shader::Shader(const char* vertexPath, const char* fragmentPath, const char* geo
 		checkCompileErrors(geometry, "GEOMETRY");
 	}
 	// shader Program
-	ID = glCreateProgram();
 	glAttachShader(ID, vertex);
 	glAttachShader(ID, fragment);
 	if (geometryPath != nullptr)
 		glAttachShader(ID, geometry);
 	glLinkProgram(ID);
 	checkCompileErrors(ID, "PROGRAM");
+	reflectUniforms();
+	if (cacheBinary)
+	{
+		GLint success = 0;
+		glGetProgramiv(ID, GL_LINK_STATUS, &success);
+		if (success)
+			ProgramCache::Write(cachePath, cacheKey, ID);
+	}
 	// delete the shaders as they're linked into our program now and no longer necessery
 	glDeleteShader(vertex);
 	glDeleteShader(fragment);
@@ -83,55 +197,224 @@ Shader::Shader(const char* vertexPath, const char* fragmentPath, const char* geo
 }
 void Shader::use()
 {
-	glUseProgram(ID);
+	GLState::UseProgram(ID);
+}
+void Shader::reflectUniforms()
+{
+	uniformLocations.clear();
+	uniformCache.clear();
+	uniformValues.clear();
+	GLint count = 0, maxLength = 0;
+	glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &count);
+	glGetProgramiv(ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+	std::vector<GLchar> buffer(maxLength > 0 ? maxLength : 1);
+	for (GLint i = 0; i < count; i++)
+	{
+		GLsizei length = 0;
+		GLint size = 0;
+		GLenum type;
+		glGetActiveUniform(ID, (GLuint)i, (GLsizei)buffer.size(), &length, &size, &type, &buffer[0]);
+		std::string name(&buffer[0], length);
+		GLint location = glGetUniformLocation(ID, name.c_str());
+		if (location < 0)
+			continue; // block members are set through their buffer
+		uniformLocations[name] = location;
+		std::vector<GLint> locations(1, location);
+
+		// arrays are reported once as "name[0]"; register every element and the bare name
+		if (size > 1 && name.size() > 3 && name.compare(name.size() - 3, 3, "[0]") == 0)
+		{
+			std::string base = name.substr(0, name.size() - 3);
+			uniformLocations[base] = location;
+			for (GLint element = 1; element < size; element++)
+			{
+				std::string elementName = base + "[" + std::to_string(element) + "]";
+				uniformLocations[elementName] = glGetUniformLocation(ID, elementName.c_str());
+				locations.push_back(uniformLocations[elementName]);
+			}
+		}
+
+		// room for the last value of every location
+		size_t valueSize = uniformValueSize(type);
+		for (size_t j = 0; j < locations.size(); j++)
+		{
+			if (valueSize == 0 || locations[j] < 0 || locations[j] > MAX_CACHED_LOCATION)
+				continue;
+			if ((size_t)locations[j] >= uniformCache.size())
+				uniformCache.resize(locations[j] + 1);
+			uniformCache[locations[j]].offset = uniformValues.size();
+			uniformCache[locations[j]].size = valueSize;
+			uniformValues.resize(uniformValues.size() + valueSize);
+		}
+	}
+}
+bool Shader::uniformChanged(GLint location, const void *value, size_t size) const
+{
+	// -1 is ignored by GL anyway
+	if (location < 0)
+		return false;
+	if ((size_t)location >= uniformCache.size() || uniformCache[location].size != size)
+	{
+		GLState::CountUniform(true);
+		return true;
+	}
+	CachedUniform &cached = uniformCache[location];
+	unsigned char *last = &uniformValues[cached.offset];
+	if (cached.known && std::memcmp(last, value, size) == 0)
+	{
+		GLState::CountUniform(false);
+		return false;
+	}
+	std::memcpy(last, value, size);
+	cached.known = true;
+	GLState::CountUniform(true);
+	return true;
+}
+GLint Shader::location(const std::string &name) const
+{
+	std::unordered_map<std::string, GLint>::const_iterator found = uniformLocations.find(name);
+	if (found != uniformLocations.end())
+		return found->second;
+	// not active (optimized out, or a spelling reflection doesn't list): ask the driver once
+	GLint location = glGetUniformLocation(ID, name.c_str());
+	uniformLocations.emplace(name, location);
+	return location;
+}
+Uniform Shader::uniform(const std::string &name) const
+{
+	Uniform uniform;
+	uniform.location = location(name);
+	return uniform;
+}
+void Shader::bindUniformBlock(const std::string &blockName, unsigned int bindingPoint) const
+{
+	GLuint index = glGetUniformBlockIndex(ID, blockName.c_str());
+	if (index != GL_INVALID_INDEX)
+		glUniformBlockBinding(ID, index, bindingPoint);
 }
 void Shader::setBool(const std::string &name, bool value) const
 {
-	glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value);
+	GLint uniformLocation = location(name);
+	int v = (int)value;
+	if (uniformChanged(uniformLocation, &v, sizeof(v)))
+		glUniform1i(uniformLocation, v);
 }
 void Shader::setInt(const std::string &name, int value) const
 {
-	glUniform1i(glGetUniformLocation(ID, name.c_str()), value);
+	GLint uniformLocation = location(name);
+	if (uniformChanged(uniformLocation, &value, sizeof(value)))
+		glUniform1i(uniformLocation, value);
 }
 void Shader::setFloat(const std::string &name, float value) const
 {
-	glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
+	GLint uniformLocation = location(name);
+	if (uniformChanged(uniformLocation, &value, sizeof(value)))
+		glUniform1f(uniformLocation, value);
 }
 void Shader::setVec2(const std::string &name, const glm::vec2 &value) const
 {
-	glUniform2fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+	GLint uniformLocation = location(name);
+	if (uniformChanged(uniformLocation, &value[0], sizeof(value)))
+		glUniform2fv(uniformLocation, 1, &value[0]);
 }
 void Shader::setVec2(const std::string &name, float x, float y) const
 {
-	glUniform2f(glGetUniformLocation(ID, name.c_str()), x, y);
+	GLint uniformLocation = location(name);
+	glm::vec2 value(x, y);
+	if (uniformChanged(uniformLocation, &value[0], sizeof(value)))
+		glUniform2f(uniformLocation, x, y);
 }
 void Shader::setVec3(const std::string &name, const glm::vec3 &value) const
 {
-	glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+	GLint uniformLocation = location(name);
+	if (uniformChanged(uniformLocation, &value[0], sizeof(value)))
+		glUniform3fv(uniformLocation, 1, &value[0]);
 }
 void Shader::setVec3(const std::string &name, float x, float y, float z) const
 {
-	glUniform3f(glGetUniformLocation(ID, name.c_str()), x, y, z);
+	GLint uniformLocation = location(name);
+	glm::vec3 value(x, y, z);
+	if (uniformChanged(uniformLocation, &value[0], sizeof(value)))
+		glUniform3f(uniformLocation, x, y, z);
 }
 void Shader::setVec4(const std::string &name, const glm::vec4 &value) const
 {
-	glUniform4fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+	GLint uniformLocation = location(name);
+	if (uniformChanged(uniformLocation, &value[0], sizeof(value)))
+		glUniform4fv(uniformLocation, 1, &value[0]);
 }
 void Shader::setVec4(const std::string &name, float x, float y, float z, float w)
 {
-	glUniform4f(glGetUniformLocation(ID, name.c_str()), x, y, z, w);
+	GLint uniformLocation = location(name);
+	glm::vec4 value(x, y, z, w);
+	if (uniformChanged(uniformLocation, &value[0], sizeof(value)))
+		glUniform4f(uniformLocation, x, y, z, w);
 }
 void Shader::setMat2(const std::string &name, const glm::mat2 &mat) const
 {
-	glUniformMatrix2fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+	GLint uniformLocation = location(name);
+	if (uniformChanged(uniformLocation, &mat[0][0], sizeof(mat)))
+		glUniformMatrix2fv(uniformLocation, 1, GL_FALSE, &mat[0][0]);
 }
 void Shader::setMat3(const std::string &name, const glm::mat3 &mat) const
 {
-	glUniformMatrix3fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+	GLint uniformLocation = location(name);
+	if (uniformChanged(uniformLocation, &mat[0][0], sizeof(mat)))
+		glUniformMatrix3fv(uniformLocation, 1, GL_FALSE, &mat[0][0]);
 }
 void Shader::setMat4(const std::string &name, const glm::mat4 &mat) const
 {
-	glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+	GLint uniformLocation = location(name);
+	if (uniformChanged(uniformLocation, &mat[0][0], sizeof(mat)))
+		glUniformMatrix4fv(uniformLocation, 1, GL_FALSE, &mat[0][0]);
+}
+
+void Shader::setBool(Uniform uniform, bool value) const
+{
+	int v = (int)value;
+	if (uniformChanged(uniform.location, &v, sizeof(v)))
+		glUniform1i(uniform.location, v);
+}
+void Shader::setInt(Uniform uniform, int value) const
+{
+	if (uniformChanged(uniform.location, &value, sizeof(value)))
+		glUniform1i(uniform.location, value);
+}
+void Shader::setFloat(Uniform uniform, float value) const
+{
+	if (uniformChanged(uniform.location, &value, sizeof(value)))
+		glUniform1f(uniform.location, value);
+}
+void Shader::setVec2(Uniform uniform, const glm::vec2 &value) const
+{
+	if (uniformChanged(uniform.location, &value[0], sizeof(value)))
+		glUniform2fv(uniform.location, 1, &value[0]);
+}
+void Shader::setVec3(Uniform uniform, const glm::vec3 &value) const
+{
+	if (uniformChanged(uniform.location, &value[0], sizeof(value)))
+		glUniform3fv(uniform.location, 1, &value[0]);
+}
+void Shader::setVec3(Uniform uniform, float x, float y, float z) const
+{
+	glm::vec3 value(x, y, z);
+	if (uniformChanged(uniform.location, &value[0], sizeof(value)))
+		glUniform3f(uniform.location, x, y, z);
+}
+void Shader::setVec4(Uniform uniform, const glm::vec4 &value) const
+{
+	if (uniformChanged(uniform.location, &value[0], sizeof(value)))
+		glUniform4fv(uniform.location, 1, &value[0]);
+}
+void Shader::setMat3(Uniform uniform, const glm::mat3 &mat) const
+{
+	if (uniformChanged(uniform.location, &mat[0][0], sizeof(mat)))
+		glUniformMatrix3fv(uniform.location, 1, GL_FALSE, &mat[0][0]);
+}
+void Shader::setMat4(Uniform uniform, const glm::mat4 &mat) const
+{
+	if (uniformChanged(uniform.location, &mat[0][0], sizeof(mat)))
+		glUniformMatrix4fv(uniform.location, 1, GL_FALSE, &mat[0][0]);
 }
 
 void Shader::checkCompileErrors(GLuint shader, std::string type)
@@ -3,21 +3,62 @@
 
 #include <glad/glad.h>
 #include <glm/glm.hpp>
+
+#include "GLHandles.h"
+
 #include <string>
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <unordered_map>
+#include <vector>
+
+// a uniform location resolved once through Shader::uniform, so per-frame updates skip the name
+// lookup; -1 (unknown or optimized out) is silently ignored by glUniform*
+struct Uniform {
+	GLint location = -1;
+};
 
 class Shader
 {
+	// every active uniform by name, filled after link; names not found are cached as -1
+	mutable std::unordered_map<std::string, GLint> uniformLocations;
+	// last value uploaded to each location (see uniformChanged)
+	struct CachedUniform {
+		size_t offset = 0;
+		size_t size = 0;
+		bool known = false;
+	};
+	mutable std::vector<CachedUniform> uniformCache;
+	mutable std::vector<unsigned char> uniformValues;
+
+	// true if value differs from what the location last got, which is then remembered;
+	// uploads that change nothing are skipped, since uniforms belong to the program
+	bool uniformChanged(GLint location, const void *value, size_t size) const;
+
+	void build(const char* vertexPath, const char* fragmentPath, const char* geometryPath, const std::vector<std::string> &defines);
+	// loads a source file, splicing in `#include "file"` lines (relative to the including file) and
+	// adding a #define for each entry of defines after the #version line
+	static std::string preprocess(const std::string &path, const std::vector<std::string> &defines, std::vector<std::string> &included);
 	void checkCompileErrors(GLuint shader, std::string type);
+	void reflectUniforms();
 public:
-	// the program ID
-	unsigned int ID;
+	// the program ID, deleted with the shader
+	GLProgram ID;
 	// constructor reads and builds the shader
 	Shader(const char* vertexPath, const char* fragmentPath, const char* geometryPath = nullptr);
-	// use/activate the shader
+	// the same with extra preprocessor definitions ("NAME" or "NAME VALUE"), see ShaderPermutations
+	Shader(const char* vertexPath, const char* fragmentPath, const std::vector<std::string> &defines, const char* geometryPath = nullptr);
+	// move-only, like the program it owns
+	Shader(Shader &&) = default;
+	Shader &operator=(Shader &&) = default;
+	// use/activate the shader; the setters below assume it is the one in use
 	void use();
+	// uniform lookup; resolve handles once outside of the render loop
+	GLint location(const std::string &name) const;
+	Uniform uniform(const std::string &name) const;
+	// attach a uniform block to a binding point (see UniformBuffer); no-op if the block is unused
+	void bindUniformBlock(const std::string &blockName, unsigned int bindingPoint) const;
 	// utility uniform functions
 	void setBool(const std::string &name, bool value) const;
 	void setInt(const std::string &name, int value) const;
@@ -31,5 +72,15 @@ public:
 	void setMat2(const std::string &name, const glm::mat2 &mat) const;
 	void setMat3(const std::string &name, const glm::mat3 &mat) const;
 	void setMat4(const std::string &name, const glm::mat4 &mat) const;
+	// the same through a resolved handle
+	void setBool(Uniform uniform, bool value) const;
+	void setInt(Uniform uniform, int value) const;
+	void setFloat(Uniform uniform, float value) const;
+	void setVec2(Uniform uniform, const glm::vec2 &value) const;
+	void setVec3(Uniform uniform, const glm::vec3 &value) const;
+	void setVec3(Uniform uniform, float x, float y, float z) const;
+	void setVec4(Uniform uniform, const glm::vec4 &value) const;
+	void setMat3(Uniform uniform, const glm::mat3 &mat) const;
+	void setMat4(Uniform uniform, const glm::mat4 &mat) const;
 };
 #endif
\ No newline at end of file
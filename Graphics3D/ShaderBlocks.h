@@ -0,0 +1,40 @@
+#ifndef SHADER_BLOCKS_H
+#define SHADER_BLOCKS_H
+
+#include <glm/glm.hpp>
+
+// CPU side of the std140 uniform blocks shared by the model and lamp shaders. std140 aligns
+// vec3 and vec4 to 16 bytes and rounds struct sizes up to 16, hence the padding members.
+
+// binding points
+const unsigned int FRAME_DATA_BINDING = 0;
+const unsigned int LIGHTS_BINDING = 1;
+
+// "FrameData": camera and fog, written once per frame; fog and night are shader permutations
+// (see ShaderPermutations), not flags in here
+struct FrameData {
+	glm::mat4 view;
+	glm::mat4 projection;
+	glm::vec3 viewPos;
+	float padding0;
+	glm::vec4 fogColor;
+	float fogDensity;
+	// clustered lighting depth slices (ClusteredLights::SliceScale/SliceBias)
+	float sliceScale;
+	float sliceBias;
+	float padding1;
+};
+static_assert(sizeof(FrameData) == 176, "FrameData must match the std140 block");
+
+// "Lights": the directional light; its ambient term is a per-draw uniform (dirLightAmbient)
+// instead, since the track is lit brighter than the props. Spot lights go through ClusteredLights.
+struct LightsData {
+	glm::vec3 dirLightDirection;
+	float padding0;
+	glm::vec3 dirLightDiffuse;
+	float padding1;
+	glm::vec3 dirLightSpecular;
+	float padding2;
+};
+static_assert(sizeof(LightsData) == 48, "LightsData must match the std140 block");
+#endif
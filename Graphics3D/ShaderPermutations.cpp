@@ -0,0 +1,36 @@
+#include "ShaderPermutations.h"
+#include "CpuProfiler.h"
+
+ShaderPermutations::ShaderPermutations(const char* vertexPath, const char* fragmentPath, const std::vector<std::string> &features)
+	: vertexPath(vertexPath), fragmentPath(fragmentPath), features(features)
+{
+}
+
+void ShaderPermutations::SetInitializer(const std::function<void(Shader &)> &initializer)
+{
+	this->initializer = initializer;
+}
+
+Shader &ShaderPermutations::Get(unsigned int key)
+{
+	std::unordered_map<unsigned int, std::unique_ptr<Shader>>::iterator found = programs.find(key);
+	if (found != programs.end())
+		return *found->second;
+	PROFILE_ZONE("compile permutation");
+
+	std::vector<std::string> defines;
+	for (size_t i = 0; i < features.size(); i++)
+	{
+		if (key & (1u << i))
+			defines.push_back(features[i]);
+	}
+	std::unique_ptr<Shader> program(new Shader(vertexPath.c_str(), fragmentPath.c_str(), defines));
+	if (initializer)
+	{
+		program->use();
+		initializer(*program);
+	}
+	Shader &result = *program;
+	programs.emplace(key, std::move(program));
+	return result;
+}
@@ -0,0 +1,30 @@
+#ifndef SHADER_PERMUTATIONS_H
+#define SHADER_PERMUTATIONS_H
+
+#include "Shader.h"
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// The programs built from one pair of sources with different sets of features switched on.
+// Feature i is the #define features[i] and bit i of the permutation key; each program is compiled
+// the first time its key is asked for and kept after that, so the shaders can use #ifdef instead
+// of branching on uniform bools and every variant only carries the code it runs.
+class ShaderPermutations
+{
+	std::string vertexPath, fragmentPath;
+	std::vector<std::string> features;
+	std::unordered_map<unsigned int, std::unique_ptr<Shader>> programs;
+	std::function<void(Shader &)> initializer;
+public:
+	ShaderPermutations(const char* vertexPath, const char* fragmentPath, const std::vector<std::string> &features);
+	// called once for every new program, while it is in use: bind blocks, set samplers
+	void SetInitializer(const std::function<void(Shader &)> &initializer);
+	// the program with exactly the features in key enabled
+	Shader &Get(unsigned int key);
+	size_t ProgramCount() const { return programs.size(); }
+};
+#endif
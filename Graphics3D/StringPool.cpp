@@ -0,0 +1,18 @@
+#include "StringPool.h"
+
+StringPool &StringPool::Instance()
+{
+	static StringPool pool;
+	return pool;
+}
+
+uint32_t StringPool::Intern(const std::string &str)
+{
+	std::unordered_map<std::string, uint32_t>::iterator found = ids.find(str);
+	if (found != ids.end())
+		return found->second;
+	uint32_t id = (uint32_t)strings.size();
+	strings.push_back(str);
+	ids.emplace(str, id);
+	return id;
+}
@@ -0,0 +1,26 @@
+#ifndef STRING_POOL_H
+#define STRING_POOL_H
+
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <unordered_map>
+
+// Process-wide table of interned strings: every distinct string is stored once and referred to
+// by a small index, e.g. the texture paths of all models' materials.
+class StringPool
+{
+	// a deque keeps the strings in place as it grows, so references stay valid
+	std::deque<std::string> strings;
+	std::unordered_map<std::string, uint32_t> ids;
+
+	StringPool() { }
+
+public:
+	static StringPool &Instance();
+
+	uint32_t Intern(const std::string &str);
+	const std::string &Get(uint32_t id) const { return strings[id]; }
+	size_t Size() const { return strings.size(); }
+};
+#endif
@@ -0,0 +1,160 @@
+#include "TextureLoader.h"
+#include "stb_image.h"
+#include "GLState.h"
+#include "CpuProfiler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <thread>
+
+typedef std::chrono::steady_clock Clock;
+
+static double millisecondsBetween(Clock::time_point start, Clock::time_point end)
+{
+	return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+unsigned int TextureLoader::Enqueue(const std::string &path, bool flipVertically)
+{
+	Job job;
+	job.path = path;
+	job.flipVertically = flipVertically;
+	job.data = nullptr;
+	job.width = job.height = job.nrComponents = 0;
+	glGenTextures(1, &job.textureID);
+	job.reference = TextureRef(job.textureID);
+	unsigned int textureID = job.textureID;
+	jobs.push_back(std::move(job));
+	return textureID;
+}
+
+void TextureLoader::decode(Job &job)
+{
+	PROFILE_FUNCTION();
+	// stbi_set_flip_vertically_on_load is global state, so flipping is done here per job instead
+	job.data = stbi_load(job.path.c_str(), &job.width, &job.height, &job.nrComponents, 0);
+	if (job.data && job.flipVertically)
+	{
+		size_t rowSize = (size_t)job.width * job.nrComponents;
+		std::vector<unsigned char> row(rowSize);
+		for (int y = 0; y < job.height / 2; y++)
+		{
+			unsigned char *top = job.data + y * rowSize;
+			unsigned char *bottom = job.data + (job.height - 1 - y) * rowSize;
+			memcpy(&row[0], top, rowSize);
+			memcpy(top, bottom, rowSize);
+			memcpy(bottom, &row[0], rowSize);
+		}
+	}
+}
+
+void TextureLoader::upload(Job &job)
+{
+	PROFILE_FUNCTION();
+	if (job.data)
+	{
+		GLenum format;
+		if (job.nrComponents == 1)
+			format = GL_RED;
+		else if (job.nrComponents == 3)
+			format = GL_RGB;
+		else if (job.nrComponents == 4)
+			format = GL_RGBA;
+
+		GLState::BindTexture(GL_TEXTURE_2D, job.textureID);
+		glTexImage2D(GL_TEXTURE_2D, 0, format, job.width, job.height, 0, format, GL_UNSIGNED_BYTE, job.data);
+		glGenerateMipmap(GL_TEXTURE_2D);
+
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+		stbi_image_free(job.data);
+		job.data = nullptr;
+	}
+	else
+	{
+		std::cout << "Texture failed to load at path: " << job.path << std::endl;
+	}
+	// may delete the texture right away, if every owner released it while it was queued
+	job.reference = TextureRef();
+}
+
+void TextureLoader::Finish(const std::string &label)
+{
+	if (jobs.empty())
+		return;
+	PROFILE_FUNCTION();
+
+	Clock::time_point start = Clock::now();
+
+	// workers pull jobs off a shared counter and hand finished images back to this thread,
+	// which uploads them as they arrive so decoded memory does not pile up
+	std::atomic<size_t> nextJob(0);
+	std::mutex mutex;
+	std::condition_variable decodedSignal;
+	std::vector<size_t> decoded;
+	Clock::time_point decodeEnd = start;
+	double decodeBusy = 0.0;
+
+	unsigned int threadCount = std::max(1u, std::thread::hardware_concurrency());
+	threadCount = (unsigned int)std::min<size_t>(threadCount, jobs.size());
+
+	std::vector<std::thread> workers;
+	for (unsigned int t = 0; t < threadCount; t++)
+	{
+		workers.push_back(std::thread([&]()
+		{
+			PROFILE_THREAD("texture decode");
+			size_t i;
+			while ((i = nextJob++) < jobs.size())
+			{
+				Clock::time_point jobStart = Clock::now();
+				decode(jobs[i]);
+				Clock::time_point jobEnd = Clock::now();
+
+				std::lock_guard<std::mutex> lock(mutex);
+				decodeBusy += millisecondsBetween(jobStart, jobEnd);
+				decodeEnd = std::max(decodeEnd, jobEnd);
+				decoded.push_back(i);
+				decodedSignal.notify_one();
+			}
+		}));
+	}
+
+	double uploadTime = 0.0;
+	size_t uploaded = 0;
+	std::vector<size_t> ready;
+	while (uploaded < jobs.size())
+	{
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			decodedSignal.wait(lock, [&]() { return !decoded.empty(); });
+			ready.swap(decoded);
+		}
+		for (size_t j = 0; j < ready.size(); j++)
+		{
+			Clock::time_point uploadStart = Clock::now();
+			upload(jobs[ready[j]]);
+			uploadTime += millisecondsBetween(uploadStart, Clock::now());
+		}
+		uploaded += ready.size();
+		ready.clear();
+	}
+
+	for (size_t t = 0; t < workers.size(); t++)
+		workers[t].join();
+
+	std::cout << "TEXTURES::" << label << "::" << jobs.size() << " textures, decode "
+		<< millisecondsBetween(start, decodeEnd) << " ms wall (" << decodeBusy << " ms on "
+		<< threadCount << " threads), upload " << uploadTime << " ms, total "
+		<< millisecondsBetween(start, Clock::now()) << " ms" << std::endl;
+
+	jobs.clear();
+}
@@ -0,0 +1,40 @@
+#ifndef TEXTURE_LOADER_H
+#define TEXTURE_LOADER_H
+
+#include <glad/glad.h>
+
+#include "TextureRegistry.h"
+
+#include <string>
+#include <vector>
+
+// Batches texture loads: images are decoded concurrently on worker threads and only
+// the glTexImage2D/mipmap upload runs on the thread that owns the GL context.
+class TextureLoader
+{
+	struct Job {
+		std::string path;
+		bool flipVertically;
+		unsigned int textureID;
+		// keeps the texture alive until it is uploaded, whoever else lets go of it first
+		TextureRef reference;
+		unsigned char *data;
+		int width, height, nrComponents;
+	};
+	std::vector<Job> jobs;
+
+	static void decode(Job &job);
+	static void upload(Job &job);
+
+public:
+	// queues a file for loading; the texture name is generated immediately so it can be
+	// handed out before the image data arrives. The loader adopts a registry reference to
+	// it (counted by TextureRegistry::Acquire) and drops it once the texture is uploaded
+	unsigned int Enqueue(const std::string &path, bool flipVertically = false);
+	// decodes everything queued so far and uploads it; must be called on the GL thread.
+	// label is used for the decode/upload timing report
+	void Finish(const std::string &label);
+
+	size_t Pending() const { return jobs.size(); }
+};
+#endif
@@ -0,0 +1,120 @@
+#include "TextureRegistry.h"
+#include "TextureLoader.h"
+#include "Hash.h"
+
+#include <vector>
+
+TextureRegistry &TextureRegistry::Instance()
+{
+	// intentionally never destroyed: models living in globals release their textures
+	// after static destructors may already have run
+	static TextureRegistry *instance = new TextureRegistry();
+	return *instance;
+}
+
+std::string TextureRegistry::ResolvePath(const std::string &path)
+{
+	std::string normalized = path;
+	for (size_t i = 0; i < normalized.size(); i++)
+	{
+		if (normalized[i] == '\\')
+			normalized[i] = '/';
+	}
+
+	std::vector<std::string> segments;
+	size_t start = 0;
+	while (start <= normalized.size())
+	{
+		size_t end = normalized.find('/', start);
+		if (end == std::string::npos)
+			end = normalized.size();
+		std::string segment = normalized.substr(start, end - start);
+		if (segment == "..")
+		{
+			if (!segments.empty() && segments.back() != "..")
+				segments.pop_back();
+			else
+				segments.push_back(segment);
+		}
+		else if (!segment.empty() && segment != ".")
+			segments.push_back(segment);
+		start = end + 1;
+	}
+
+	std::string resolved = (!normalized.empty() && normalized[0] == '/') ? "/" : "";
+	for (size_t i = 0; i < segments.size(); i++)
+	{
+		if (i > 0)
+			resolved += '/';
+		resolved += segments[i];
+	}
+	return resolved;
+}
+
+unsigned int TextureRegistry::Acquire(const std::string &path, TextureLoader &loader, bool flipVertically)
+{
+	// the same file loaded flipped and unflipped are two different textures
+	std::string key = ResolvePath(path) + (flipVertically ? "|flipped" : "");
+
+	std::unordered_map<std::string, unsigned int>::iterator found = byPath.find(key);
+	if (found != byPath.end())
+	{
+		entries[found->second].refCount++;
+		return found->second;
+	}
+
+	uint64_t contentKey = FNV_OFFSET_BASIS;
+	bool hasContentKey = hashContents && HashFile(path, contentKey);
+	if (hasContentKey)
+	{
+		contentKey = HashValue(flipVertically, contentKey);
+		std::unordered_map<uint64_t, unsigned int>::iterator sameContent = byContent.find(contentKey);
+		if (sameContent != byContent.end())
+		{
+			// another path to an image we already have: alias it
+			byPath[key] = sameContent->second;
+			entries[sameContent->second].refCount++;
+			return sameContent->second;
+		}
+	}
+
+	unsigned int id = loader.Enqueue(path, flipVertically);
+	Entry entry;
+	entry.texture.reset(id);
+	entry.key = key;
+	entry.contentKey = contentKey;
+	entry.hasContentKey = hasContentKey;
+	// the caller's reference and the one the loader holds until the upload
+	entry.refCount = 2;
+	entries[id] = std::move(entry);
+	byPath[key] = id;
+	if (hasContentKey)
+		byContent[contentKey] = id;
+	return id;
+}
+
+void TextureRegistry::AddRef(unsigned int id)
+{
+	std::unordered_map<unsigned int, Entry>::iterator found = entries.find(id);
+	if (found != entries.end())
+		found->second.refCount++;
+}
+
+void TextureRegistry::Release(unsigned int id)
+{
+	std::unordered_map<unsigned int, Entry>::iterator found = entries.find(id);
+	if (found == entries.end() || --found->second.refCount > 0)
+		return;
+
+	// drop every path that was aliased to this texture, then the texture itself
+	for (std::unordered_map<std::string, unsigned int>::iterator it = byPath.begin(); it != byPath.end();)
+	{
+		if (it->second == id)
+			it = byPath.erase(it);
+		else
+			++it;
+	}
+	if (found->second.hasContentKey)
+		byContent.erase(found->second.contentKey);
+	entries.erase(found);
+}
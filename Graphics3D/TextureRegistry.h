@@ -0,0 +1,97 @@
+#ifndef TEXTURE_REGISTRY_H
+#define TEXTURE_REGISTRY_H
+
+#include "GLHandles.h"
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+
+class TextureLoader;
+
+// Process-wide table of loaded textures, shared by every Model and FileTexture.
+// Textures are keyed by their resolved path (and optionally by a hash of the file
+// contents, so copies of the same image under different names share one GL texture)
+// and reference counted; the GL texture is deleted when its last reference goes away.
+class TextureRegistry
+{
+	struct Entry {
+		// deleted with the entry
+		GLTexture texture;
+		std::string key;
+		uint64_t contentKey;
+		bool hasContentKey;
+		unsigned int refCount;
+	};
+	std::unordered_map<std::string, unsigned int> byPath;
+	std::unordered_map<uint64_t, unsigned int> byContent;
+	std::unordered_map<unsigned int, Entry> entries;
+	bool hashContents;
+
+	TextureRegistry() : hashContents(false) { }
+
+public:
+	static TextureRegistry &Instance();
+
+	// normalizes separators and "." / ".." segments so different spellings of a path match
+	static std::string ResolvePath(const std::string &path);
+
+	void SetContentHashing(bool enabled) { hashContents = enabled; }
+
+	// returns a new reference to the texture for path; if it is not resident yet it is
+	// queued on loader and becomes valid once loader.Finish() has run (the loader holds a
+	// reference of its own until then, so the caller may release its one early)
+	unsigned int Acquire(const std::string &path, TextureLoader &loader, bool flipVertically = false);
+	void AddRef(unsigned int id);
+	void Release(unsigned int id);
+
+	size_t Size() const { return entries.size(); }
+};
+
+// Owning reference to a registry texture
+class TextureRef
+{
+	unsigned int id;
+
+public:
+	TextureRef() : id(0) { }
+	// adopts a reference returned by TextureRegistry::Acquire
+	explicit TextureRef(unsigned int id) : id(id) { }
+	TextureRef(const TextureRef &other) : id(other.id)
+	{
+		if (id)
+			TextureRegistry::Instance().AddRef(id);
+	}
+	TextureRef(TextureRef &&other) : id(other.id)
+	{
+		other.id = 0;
+	}
+	TextureRef &operator=(TextureRef &&other)
+	{
+		if (this != &other)
+		{
+			if (id)
+				TextureRegistry::Instance().Release(id);
+			id = other.id;
+			other.id = 0;
+		}
+		return *this;
+	}
+	TextureRef &operator=(const TextureRef &other)
+	{
+		if (other.id)
+			TextureRegistry::Instance().AddRef(other.id);
+		if (id)
+			TextureRegistry::Instance().Release(id);
+		id = other.id;
+		return *this;
+	}
+	~TextureRef()
+	{
+		if (id)
+			TextureRegistry::Instance().Release(id);
+	}
+
+	unsigned int get() const { return id; }
+};
+#endif
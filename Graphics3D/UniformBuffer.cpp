@@ -0,0 +1,23 @@
+#include "UniformBuffer.h"
+#include "RenderStats.h"
+
+UniformBuffer::UniformBuffer(size_t size, unsigned int bindingPoint)
+{
+	this->size = size;
+	this->bindingPoint = bindingPoint;
+	ID = GLBuffer::Create();
+	glBindBuffer(GL_UNIFORM_BUFFER, ID);
+	glBufferData(GL_UNIFORM_BUFFER, size, NULL, GL_DYNAMIC_DRAW);
+	glBindBufferBase(GL_UNIFORM_BUFFER, bindingPoint, ID);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+void UniformBuffer::update(const void *data)
+{
+	glBindBuffer(GL_UNIFORM_BUFFER, ID);
+	// orphan the old storage first, so the driver doesn't wait for draws still reading last frame's data
+	glBufferData(GL_UNIFORM_BUFFER, size, NULL, GL_DYNAMIC_DRAW);
+	glBufferSubData(GL_UNIFORM_BUFFER, 0, size, data);
+	RenderStats::CountBufferUpload(size);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
@@ -0,0 +1,23 @@
+#ifndef UNIFORM_BUFFER_H
+#define UNIFORM_BUFFER_H
+
+#include <glad/glad.h>
+
+#include "GLHandles.h"
+
+#include <cstddef>
+
+// A uniform buffer object attached to a binding point; every shader whose block is bound to
+// the same point (Shader::bindUniformBlock) reads from it
+class UniformBuffer
+{
+	size_t size;
+public:
+	GLBuffer ID;
+	unsigned int bindingPoint;
+
+	UniformBuffer(size_t size, unsigned int bindingPoint);
+	// replaces the whole contents; meant to be called at most once per frame
+	void update(const void *data);
+};
+#endif
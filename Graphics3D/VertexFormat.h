@@ -0,0 +1,73 @@
+#ifndef VERTEX_FORMAT_H
+#define VERTEX_FORMAT_H
+
+#include <glm/glm.hpp>
+#include <glm/gtc/packing.hpp>
+
+#include <cmath>
+#include <cstdint>
+
+// Layout of a mesh's vertex buffer on the GPU
+enum VertexFormat {
+	// the 56-byte Vertex struct as is
+	VERTEX_FORMAT_FULL,
+	// 16 bytes (20 with tangents): 16-bit positions dequantized with a per-mesh offset and
+	// scale, octahedral-encoded normal and tangent, half-float texture coordinates
+	VERTEX_FORMAT_COMPACT
+};
+
+struct CompactVertex {
+	// position inside the mesh bounds as snorm16; w holds the bitangent sign
+	int16_t Position[4];
+	// octahedral normal as snorm16
+	int16_t Normal[2];
+	// texture coordinates as half floats
+	uint16_t TexCoords[2];
+};
+
+struct CompactTangentVertex {
+	int16_t Position[4];
+	int16_t Normal[2];
+	uint16_t TexCoords[2];
+	// octahedral tangent as snorm16
+	int16_t Tangent[2];
+};
+
+inline int16_t PackSnorm16(float value)
+{
+	value = glm::clamp(value, -1.0f, 1.0f);
+	return (int16_t)std::floor(value * 32767.0f + 0.5f);
+}
+
+// as the GPU reads a normalized GL_SHORT attribute
+inline float UnpackSnorm16(int16_t value)
+{
+	return glm::max(value / 32767.0f, -1.0f);
+}
+
+// maps a unit vector onto the [-1, 1] square (Meyer et al., "On Floating-Point Normal Vectors")
+inline glm::vec2 OctEncode(glm::vec3 n)
+{
+	float length1 = std::fabs(n.x) + std::fabs(n.y) + std::fabs(n.z);
+	if (length1 == 0.0f)
+		return glm::vec2(0.0f);
+	n /= length1;
+	glm::vec2 encoded(n.x, n.y);
+	if (n.z < 0.0f)
+	{
+		encoded.x = (1.0f - std::fabs(n.y)) * (n.x >= 0.0f ? 1.0f : -1.0f);
+		encoded.y = (1.0f - std::fabs(n.x)) * (n.y >= 0.0f ? 1.0f : -1.0f);
+	}
+	return encoded;
+}
+
+// the inverse of OctEncode, as the vertex shader has it
+inline glm::vec3 OctDecode(glm::vec2 e)
+{
+	glm::vec3 n(e.x, e.y, 1.0f - std::fabs(e.x) - std::fabs(e.y));
+	float t = glm::max(-n.z, 0.0f);
+	n.x += n.x >= 0.0f ? -t : t;
+	n.y += n.y >= 0.0f ? -t : t;
+	return glm::normalize(n);
+}
+#endif
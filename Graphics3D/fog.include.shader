@@ -0,0 +1,8 @@
+float CalcFogFactor(vec3 fragPos, vec3 viewPos, float density)
+{
+	float dist = distance(viewPos, fragPos);
+	float fogFactor = 1.0 / exp((dist * density)* (dist * density));
+	fogFactor = clamp(fogFactor, 0.0, 1.0);
+
+	return fogFactor;
+}
\ No newline at end of file
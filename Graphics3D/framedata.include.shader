@@ -0,0 +1,11 @@
+//per-frame camera and fog, shared by the model and lamp shaders (see ShaderBlocks.h)
+layout(std140) uniform FrameData {
+	mat4 view;
+	mat4 projection;
+	vec3 viewPos;
+	vec4 fogColor;
+	float fogDensity;
+	//clustered lighting: depth slice = log(depth) * sliceScale + sliceBias
+	float sliceScale;
+	float sliceBias;
+};
\ No newline at end of file
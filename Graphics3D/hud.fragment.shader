@@ -0,0 +1,13 @@
+#version 330 core
+in vec2 TexCoords;
+in vec4 Color;
+
+out vec4 FragColor;
+
+// font coverage in the red channel
+uniform sampler2D atlas;
+
+void main()
+{
+	FragColor = vec4(Color.rgb, Color.a * texture(atlas, TexCoords).r);
+}
@@ -0,0 +1,17 @@
+#version 330 core
+layout(location = 0) in vec2 aPos;
+layout(location = 1) in vec2 aTexCoords;
+layout(location = 2) in vec4 aColor;
+
+// in pixels; aPos counts from the top left corner
+uniform vec2 screenSize;
+
+out vec2 TexCoords;
+out vec4 Color;
+
+void main()
+{
+	gl_Position = vec4(aPos.x / screenSize.x * 2.0 - 1.0, 1.0 - aPos.y / screenSize.y * 2.0, 0.0, 1.0);
+	TexCoords = aTexCoords;
+	Color = aColor;
+}
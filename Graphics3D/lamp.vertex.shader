@@ -1,13 +1,22 @@
 #version 330 core
 layout(location = 0) in vec3 aPos;
+#ifdef INSTANCED
+layout(location = 5) in mat4 aInstanceModel;
+#else
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+#endif
+
+#include "framedata.include.shader"
 
 out vec3 FragPos;
 
 void main()
 {
-	gl_Position = projection * view * model * vec4(aPos, 1.0);
-	FragPos = vec3(model * vec4(aPos, 1.0));
+#ifdef INSTANCED
+	mat4 modelMatrix = aInstanceModel;
+#else
+	mat4 modelMatrix = model;
+#endif
+	gl_Position = projection * view * modelMatrix * vec4(aPos, 1.0);
+	FragPos = vec3(modelMatrix * vec4(aPos, 1.0));
 }
\ No newline at end of file
@@ -0,0 +1,201 @@
+//lighting shared by the per-vertex (GOURAUD) and per-fragment paths of the model shader;
+//include framedata and fog first. ENABLE_FOG and ENABLE_NIGHT select the scene lighting.
+struct DirLight {
+	vec3 direction;
+
+	vec3 ambient;
+	vec3 diffuse;
+	vec3 specular;
+};
+
+struct PointLight {
+	vec3 position;
+
+	vec3 ambient;
+	vec3 diffuse;
+	vec3 specular;
+
+	float constant;
+	float linear;
+	float quadratic;
+};
+#define NR_POINT_LIGHTS 4
+uniform PointLight pointLights[NR_POINT_LIGHTS];
+
+struct SpotLight {
+	vec3 position;
+	vec3 direction;
+	float cutOff;
+	float outerCutOff;
+
+	vec3 ambient;
+	vec3 diffuse;
+	vec3 specular;
+
+	float constant;
+	float linear;
+	float quadratic;
+	float radius;
+};
+//directional light (see ShaderBlocks.h)
+layout(std140) uniform Lights {
+	vec3 dirLightDirection;
+	vec3 dirLightDiffuse;
+	vec3 dirLightSpecular;
+};
+
+//spot lights, assigned to a froxel grid every frame (see ClusteredLights.h)
+#define CLUSTER_X 16
+#define CLUSTER_Y 9
+#define CLUSTER_Z 24
+uniform samplerBuffer lightData;
+uniform usamplerBuffer clusterGrid;
+uniform usamplerBuffer lightIndices;
+//per draw: the track is lit brighter than the props
+uniform vec3 dirLightAmbient;
+
+uniform sampler2D texture_diffuse1;
+uniform sampler2D texture_specular1;
+uniform float texture_diffuse1_shininess;
+uniform float texture_specular1_shininess;
+
+vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir, vec2 texCoords);
+vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir, vec2 texCoords);
+vec3 CalcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir, vec2 texCoords);
+vec3 CalcClusterLights(vec3 normal, vec3 fragPos, vec3 viewDir, vec2 texCoords);
+
+vec4 CalcShading(vec3 normal, vec3 fragPos, vec2 texCoords)
+{
+	// properties
+	vec3 norm = normalize(normal);
+	vec3 viewDir = normalize(viewPos - fragPos);
+
+	vec3 result = vec3(0.0, 0.0, 0.0);
+	// phase 1: Directional lighting, off at night and dimmed in the fog
+#ifndef ENABLE_NIGHT
+	DirLight dirLight = DirLight(dirLightDirection, dirLightAmbient, dirLightDiffuse, dirLightSpecular);
+#ifdef ENABLE_FOG
+	dirLight.ambient /= 2;
+	dirLight.diffuse /= 2;
+	dirLight.specular /= 2;
+#endif
+	result += CalcDirLight(dirLight, norm, viewDir, texCoords);
+#endif
+
+	//// phase 2: Point lights
+	//for (int i = 0; i < NR_POINT_LIGHTS; i++)
+	//	result += CalcPointLight(pointLights[i], norm, fragPos, viewDir, texCoords);
+
+	// phase 3: Spot lights
+	result += CalcClusterLights(norm, fragPos, viewDir, texCoords);
+
+#ifdef ENABLE_FOG
+	float fogFactor = CalcFogFactor(fragPos, viewPos, fogDensity);
+	return mix(fogColor, vec4(result, 1.0), fogFactor);
+#else
+	return vec4(result, 1.0);
+#endif
+}
+
+vec3 CalcClusterLights(vec3 normal, vec3 fragPos, vec3 viewDir, vec2 texCoords)
+{
+	// find the cluster from the view-space position
+	vec4 viewSpace = view * vec4(fragPos, 1.0);
+	vec4 clip = projection * viewSpace;
+	vec2 ndc = clip.xy / clip.w;
+	int x = clamp(int((ndc.x * 0.5 + 0.5) * CLUSTER_X), 0, CLUSTER_X - 1);
+	int y = clamp(int((ndc.y * 0.5 + 0.5) * CLUSTER_Y), 0, CLUSTER_Y - 1);
+	int z = clamp(int(floor(log(-viewSpace.z) * sliceScale + sliceBias)), 0, CLUSTER_Z - 1);
+	uvec2 cluster = texelFetch(clusterGrid, (z * CLUSTER_Y + y) * CLUSTER_X + x).xy;
+
+	vec3 result = vec3(0.0);
+	for (uint i = 0u; i < cluster.y; i++)
+	{
+		int base = int(texelFetch(lightIndices, int(cluster.x + i)).r) * 6;
+		vec4 t0 = texelFetch(lightData, base);
+		vec4 t1 = texelFetch(lightData, base + 1);
+		vec4 t2 = texelFetch(lightData, base + 2);
+		vec4 t3 = texelFetch(lightData, base + 3);
+		vec4 t4 = texelFetch(lightData, base + 4);
+		vec4 t5 = texelFetch(lightData, base + 5);
+		SpotLight light = SpotLight(t0.xyz, t1.xyz, t0.w, t1.w, t2.xyz, t3.xyz, t4.xyz, t2.w, t3.w, t4.w, t5.x);
+		result += CalcSpotLight(light, normal, fragPos, viewDir, texCoords);
+	}
+	return result;
+}
+
+vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir, vec2 texCoords)
+{
+	vec3 lightDir = normalize(-light.direction);
+	// diffuse shading
+	float diff = max(dot(normal, lightDir), 0.0);
+	// specular shading
+	vec3 reflectDir = reflect(-lightDir, normal);
+	float spec = pow(max(dot(viewDir, reflectDir), 0.0), texture_diffuse1_shininess);
+	// combine results
+	vec3 ambient = light.ambient * vec3(texture(texture_diffuse1, texCoords));
+	vec3 diffuse = light.diffuse * diff * vec3(texture(texture_diffuse1, texCoords));
+	vec3 specular = light.specular * spec * vec3(texture(texture_specular1, texCoords));
+	return (ambient + diffuse + specular);
+}
+
+vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir, vec2 texCoords)
+{
+	vec3 lightDir = normalize(light.position - fragPos);
+	// diffuse shading
+	float diff = max(dot(normal, lightDir), 0.0);
+	// specular shading
+	vec3 reflectDir = reflect(-lightDir, normal);
+	float spec = pow(max(dot(viewDir, reflectDir), 0.0), texture_diffuse1_shininess);
+	// attenuation
+	float distance = length(light.position - fragPos);
+	float attenuation = 1.0 / (light.constant + light.linear * distance + light.quadratic * (distance * distance));
+	// combine results
+	vec3 ambient = light.ambient * vec3(texture(texture_diffuse1, texCoords));
+	vec3 diffuse = light.diffuse * diff * vec3(texture(texture_diffuse1, texCoords));
+	vec3 specular = light.specular * spec * vec3(texture(texture_specular1, texCoords));
+
+	ambient *= attenuation;
+	diffuse *= attenuation;
+	specular *= attenuation;
+
+	return (ambient + diffuse + specular);
+}
+
+vec3 CalcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir, vec2 texCoords)
+{
+	vec3 lightDir = normalize(light.position - fragPos);
+
+	// diffuse
+	float diff = max(dot(normal, lightDir), 0.0);
+
+	// specular
+	vec3 reflectDir = reflect(-lightDir, normal);
+	float spec = pow(max(dot(viewDir, reflectDir), 0.0), texture_diffuse1_shininess);
+
+	//attenuation
+	float distance = length(light.position - fragPos);
+	float attenuation = 1.0 / (light.constant + light.linear * distance + light.quadratic * (distance * distance));
+	//faded out towards the radius, so the clusters the light isn't assigned to show no edge
+	float falloff = clamp(1.0 - pow(distance / light.radius, 4.0), 0.0, 1.0);
+	attenuation *= falloff * falloff;
+
+	//spotlight
+	float theta = dot(lightDir, normalize(-light.direction));
+	float epsilon = light.cutOff - light.outerCutOff;
+	float intensity = clamp((theta - light.outerCutOff) / epsilon, 0.0, 1.0);
+
+	// combine results
+	vec3 ambient = light.ambient * vec3(texture(texture_diffuse1, texCoords));
+	vec3 diffuse = light.diffuse * diff * vec3(texture(texture_diffuse1, texCoords));
+	vec3 specular = light.specular * spec * vec3(texture(texture_specular1, texCoords));
+
+	ambient *= attenuation * 0;
+	diffuse *= attenuation;
+	specular *= attenuation;
+
+	diffuse *= intensity;
+	specular *= intensity;
+
+	return (ambient + diffuse + specular);
+}
\ No newline at end of file
@@ -8,9 +8,28 @@
 #include "Shader.h"
 #include "Camera.h"
 #include "Model.h"
-
+#include "UniformBuffer.h"
+#include "ShaderBlocks.h"
+#include "ShaderPermutations.h"
+#include "ClusteredLights.h"
+#include "RenderQueue.h"
+#include "GLState.h"
+#include "GLHandles.h"
+#include "OffscreenContext.h"
+#include "RenderTarget.h"
+#include "InputLog.h"
+#include "GpuProfiler.h"
+#include "CpuProfiler.h"
+#include "RenderStats.h"
+#include "Hud.h"
+
+#include <chrono>
+#include <climits>
+#include <cstdio>
+#include <fstream>
 #include <iostream>
 #include <cmath>
+#include <memory>
 
 #define NUM_CAMERAS 4
 #define NUM_LIGHT_POLES 4
@@ -18,12 +37,18 @@
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void mouse_callback(GLFWwindow* window, double xpos, double ypos);
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
-void processInput(GLFWwindow *window);
+void pollInput(GLFWwindow *window, InputState &input);
+void processInput(const InputState &input);
+void printMemoryReport(const char *name, const Model &model);
+double secondsSinceStart();
 AbstractCamera* GetCamera();
 
 // settings
 const unsigned int SCR_WIDTH = 800;
 const unsigned int SCR_HEIGHT = 600;
+// the size actually rendered at: the window's framebuffer, or --size
+unsigned int screenWidth = SCR_WIDTH;
+unsigned int screenHeight = SCR_HEIGHT;
 
 // cameras
 Camera fpsCamera(glm::vec3(0.0f, -1.0f, 3.0f));
@@ -41,10 +66,14 @@ Model carModel;
 float lastX = SCR_WIDTH / 2.0f;
 float lastY = SCR_HEIGHT / 2.0f;
 bool firstMouse = true;
+// mouse and wheel movement since the last pollInput
+float mouseDeltaX = 0.0f;
+float mouseDeltaY = 0.0f;
+float scrollDelta = 0.0f;
 
 // timing
-float deltaTime = 0.0f;
 float lastFrame = 0.0f;
+float lastStatsUpdate = 0.0f;
 
 //fog
 bool enableFog = false;
@@ -78,44 +107,131 @@ float reflectorHeight = -0.1f;
 //gouraud
 bool gouraud = false;
 
-int main()
-{
-	// glfw: initialize and configure
-	// ------------------------------
-	glfwInit();
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-
-#ifdef __APPLE__
-	glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE); // uncomment this statement to fix compilation on OS X
-#endif
+//statistics overlay
+bool showHud = false;
+
+// shader permutation bits and the #defines they switch on
+const unsigned int GOURAUD_FEATURE = 1 << 0;
+const unsigned int FOG_FEATURE = 1 << 1;
+const unsigned int NIGHT_FEATURE = 1 << 2;
+// then the geometry's own, INSTANCED_FEATURE and COMPACT_VERTEX_FEATURE (see Mesh.h)
+const std::vector<std::string> SHADER_FEATURES = { "GOURAUD", "ENABLE_FOG", "ENABLE_NIGHT", "INSTANCED", "COMPACT_VERTEX" };
+
+// command line; a headless run renders a fixed number of frames offscreen and reports the time,
+// e.g. on a build machine without GPU or display:
+//   Graphics3D --headless [--size 1280x720] [--frames 300] [--capture last.ppm]
+// --record saves the input of every frame and --replay plays such a file back instead of reading
+// the keyboard and mouse, so two runs take the same path; --timings writes per-frame times as CSV:
+//   Graphics3D --record drive.g3dinput --timestep 0.016667
+//   Graphics3D --headless --replay drive.g3dinput --timings after.csv
+// --gpu-profile times every model and the lamps on the GPU and prints min/avg/p99 per pass on exit;
+// --gpu-timings also writes every frame's pass times as CSV; --trace saves the CPU zones of loading
+// and of every frame for chrome://tracing (only recorded in builds with G3D_PROFILE defined);
+// --hud starts with the overlay of draw calls, triangles, binds, uploads and frame times shown (F1)
+struct LaunchOptions {
+	bool headless = false;
+	// 0: 300 headless frames, or all of the replay
+	unsigned int frames = 0;
+	// simulated seconds per frame; 0 follows the clock (headless runs default to 1/60)
+	float timestep = 0.0f;
+	// where the last headless frame is saved, if anywhere
+	std::string capturePath;
+	std::string recordPath;
+	std::string replayPath;
+	std::string timingsPath;
+	bool gpuProfile = false;
+	std::string gpuTimingsPath;
+	std::string tracePath;
+	bool hud = false;
+};
+bool parseArguments(int argc, char **argv, LaunchOptions &options);
+void writeCapture(const std::string &path, const RenderTarget &target);
 
-	// glfw window creation
-	// --------------------
-	GLFWwindow* window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "Graphics 3D", NULL, NULL);
-	if (window == NULL)
+// releases the context (GLFW's or the offscreen one) on the way out of main; declared before the
+// GL objects so their owners are destroyed, and delete them, while the context still exists
+struct ContextTerminator {
+	~ContextTerminator()
 	{
-		std::cout << "Failed to create GLFW window" << std::endl;
+		OffscreenContext::Destroy();
 		glfwTerminate();
-		return -1;
 	}
-	glfwMakeContextCurrent(window);
-	glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
-	glfwSetCursorPosCallback(window, mouse_callback);
-	glfwSetScrollCallback(window, scroll_callback);
+};
 
-	// tell GLFW to capture our mouse
-	glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+int main(int argc, char **argv)
+{
+	LaunchOptions launch;
+	if (!parseArguments(argc, argv, launch))
+		return -1;
+	PROFILE_THREAD("main");
 
-	// glad: load all OpenGL function pointers
-	// ---------------------------------------
-	if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+	// the replay is read before any GL object exists, so a bad file has nothing to tear down
+	InputLog inputLog;
+	bool replaying = !launch.replayPath.empty();
+	if (replaying && !inputLog.Load(launch.replayPath))
 	{
-		std::cout << "Failed to initialize GLAD" << std::endl;
+		std::cout << "ERROR::INPUT_LOG::FAILED_TO_READ " << launch.replayPath << std::endl;
 		return -1;
 	}
 
+	// headless runs first try a context that needs no window system at all
+	GLFWwindow* window = NULL;
+	bool offscreen = launch.headless && OffscreenContext::Create();
+	if (!offscreen)
+	{
+		// glfw: initialize and configure
+		// ------------------------------
+		glfwInit();
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+		glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+		// otherwise a window that is never shown
+		if (launch.headless)
+			glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
+#ifdef __APPLE__
+		glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE); // uncomment this statement to fix compilation on OS X
+#endif
+
+		// glfw window creation
+		// --------------------
+		window = glfwCreateWindow(screenWidth, screenHeight, "Graphics 3D", NULL, NULL);
+		if (window == NULL)
+		{
+			std::cout << "Failed to create GLFW window" << std::endl;
+			glfwTerminate();
+			return -1;
+		}
+		glfwMakeContextCurrent(window);
+		if (!launch.headless)
+		{
+			glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+			glfwSetCursorPosCallback(window, mouse_callback);
+			glfwSetScrollCallback(window, scroll_callback);
+
+			// tell GLFW to capture our mouse
+			glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+		}
+
+		// glad: load all OpenGL function pointers
+		// ---------------------------------------
+		if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+		{
+			std::cout << "Failed to initialize GLAD" << std::endl;
+			return -1;
+		}
+	}
+	ContextTerminator terminator;
+
+	// headless frames go to a framebuffer of their own: there may be no default one
+	std::unique_ptr<RenderTarget> renderTarget;
+	if (launch.headless)
+	{
+		renderTarget = std::make_unique<RenderTarget>(screenWidth, screenHeight);
+		if (!renderTarget->IsComplete())
+			return -1;
+		renderTarget->Bind();
+	}
+
 	// configure global opengl state
 	// -----------------------------
 	glEnable(GL_DEPTH_TEST);
@@ -172,11 +288,20 @@ int main()
 
 	// build and compile shaders
 	// -------------------------
-	Shader ourShader("model.vertex.shader", "model.fragment.shader");
-	ourShader.use();
+	// shading model, fog and night are compiled into the programs rather than branched on;
+	// every combination is built the first time it is toggled on
+
+	// spot lights are looked up per cluster of the view frustum
+	ClusteredLights clusteredLights;
+	RenderQueue renderQueue;
 
-	ourShader.setFloat("fogDensity", fogDensity);
-	ourShader.setVec4("fogColor", fogColor);
+	ShaderPermutations modelShaders("model.vertex.shader", "model.fragment.shader", SHADER_FEATURES);
+	modelShaders.SetInitializer([&clusteredLights](Shader &shader)
+	{
+		clusteredLights.SetSamplers(shader);
+		shader.bindUniformBlock("FrameData", FRAME_DATA_BINDING);
+		shader.bindUniformBlock("Lights", LIGHTS_BINDING);
+	});
 
 	// load models
 	// -----------
@@ -184,23 +309,27 @@ int main()
 	//Model ourModel("Models/Mercedes/Mercedes-Benz CL600 2007 OBJ.obj");
 	//Model ourModel("Models/nanosuit/nanosuit.obj");
 
-	carModel = Model("Models/Mustang/mustang_GT.obj");
+	// nothing reads the geometry back on the CPU, so the GPU buffers are the only copy
+	ModelOptions modelOptions;
+	modelOptions.residency = CPU_RESIDENCY_DISCARD;
+
+	carModel = Model("Models/Mustang/mustang_GT.obj", modelOptions);
 	carModel.position = glm::vec3(8.8f, -1.77f, 0.0f);
 	carModel.rotation = -12.0f;
 
 	//Model streetModel("Models/Street environment/Street environment_V01.obj");
 	//Model streetModel("Models/city/gmae.obj");
 	//Model streetModel("Models/metro/Metro_1.3ds");
-	Model streetModel("Models/Track01/track01_.3ds");
+	Model streetModel("Models/Track01/track01_.3ds", modelOptions);
 
 
-	Model otherModel = Model("Models/Cup/Coffee_Cup.obj");
+	Model otherModel = Model("Models/Cup/Coffee_Cup.obj", modelOptions);
 	//Model otherModel = Model("Models/House/farmhouse_obj.obj");
 	//Model otherModel = Model("Models/Sphere/sphere-1.obj");
 	//Model otherModel = Model("Models/Sphere/sphere-and-cube-lxo-test.obj");
 	//Model otherModel = Model("Models/Ball/earth.3ds");
 
-	Model lightPoleModel = Model("Models/Light Pole/Light Pole.obj");
+	Model lightPoleModel = Model("Models/Light Pole/Light Pole.obj", modelOptions);
 	//Model streetModel("Models/Camellia City/OBJ/Camellia City.obj");
 
 	// draw in wireframe
@@ -208,78 +337,196 @@ int main()
 
 	//carCamera.SetYawPitch(-90.0f, -20);
 
-	Shader lampShader("lamp.vertex.shader", "lamp.fragment.shader");
-	lampShader.use();
-	lampShader.setFloat("fogDensity", fogDensity * 1 / 2
-	);
-	lampShader.setVec4("fogColor", fogColor);
+	ShaderPermutations lampShaders("lamp.vertex.shader", "lamp.fragment.shader", SHADER_FEATURES);
+	lampShaders.SetInitializer([](Shader &shader)
+	{
+		shader.bindUniformBlock("FrameData", FRAME_DATA_BINDING);
+	});
+
+	// camera, fog and lights live in uniform buffers shared by both shaders, written once per frame
+	UniformBuffer frameDataBuffer(sizeof(FrameData), FRAME_DATA_BINDING);
+	UniformBuffer lightsBuffer(sizeof(LightsData), LIGHTS_BINDING);
 
-	unsigned int VBO;
-	glGenBuffers(1, &VBO);
+	GLBuffer VBO = GLBuffer::Create();
 	glBindBuffer(GL_ARRAY_BUFFER, VBO);
 	glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
 
-	unsigned int lightVAO;
-	glGenVertexArrays(1, &lightVAO);
-	glBindVertexArray(lightVAO);
+	GLVertexArray lightVAO = GLVertexArray::Create();
+	GLState::BindVertexArray(lightVAO);
 	// we only need to bind to the VBO (to link it with glVertexAttribPointer), no need to fill it; the VBO's data already contains all we need (it's already bound, but we do it again for educational purposes)
 	glBindBuffer(GL_ARRAY_BUFFER, VBO);
 	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
 	glEnableVertexAttribArray(0);
 
+	// the light poles don't move: place them and their lamp cubes once, drawn instanced
+	vector<glm::mat4> lightPoleModelMatrices(NUM_LIGHT_POLES);
+	vector<glm::mat4> lampCubeModelMatrices(NUM_LIGHT_POLES);
+	glm::vec3 lightPoleLampPositions[NUM_LIGHT_POLES];
+	for (int i = 0; i < NUM_LIGHT_POLES; i++)
+	{
+		glm::mat4 lightPoleModelMatrix = glm::mat4(1.0f);
+		lightPoleModelMatrix = glm::translate(lightPoleModelMatrix, lightPolePositions[i]); // translate it down so it's at the center of the scene
+		lightPoleModelMatrix = glm::rotate(lightPoleModelMatrix, glm::radians(lightPoleRotations[i]), glm::vec3(0.0f, 1.0f, 0.0f));	// rotation
+		lightPoleModelMatrix = glm::scale(lightPoleModelMatrix, glm::vec3(0.05f));	// it's a bit too big for our scene, so scale it down
+		lightPoleModelMatrices[i] = lightPoleModelMatrix;
+
+		lightPoleLampPositions[i] = glm::vec3(lightPoleModelMatrix * glm::vec4(0.0f, 11.0f, -6.0f, 1.0f));
+		glm::mat4 cubemodel = glm::mat4(1.0f);
+		cubemodel = glm::translate(cubemodel, lightPoleLampPositions[i]);
+		cubemodel = glm::scale(cubemodel, glm::vec3(0.1f)); // a smaller cube
+		lampCubeModelMatrices[i] = cubemodel;
+	}
+	lightPoleModel.SetInstances(lightPoleModelMatrices);
+
+	printMemoryReport("car", carModel);
+	printMemoryReport("street", streetModel);
+	printMemoryReport("cup", otherModel);
+	printMemoryReport("light pole", lightPoleModel);
+
+	// lights: only the car's headlights move, the rest is set up here once
+	LightsData lights = {};
+	//directional light
+	lights.dirLightDirection = glm::vec3(-0.2f, -1.0f, -0.3f);
+	lights.dirLightDiffuse = glm::vec3(0.5f, 0.5f, 0.5f);
+	lights.dirLightSpecular = glm::vec3(1.0f, 1.0f, 1.0f);
+	lightsBuffer.update(&lights);
+	//headlights
+	vector<SpotLight> spotLights(2 + NUM_LIGHT_POLES);
+	for (int i = 0; i < 2; i++)
+	{
+		spotLights[i].cutOff = glm::cos(glm::radians(20.0f));
+		spotLights[i].outerCutOff = glm::cos(glm::radians(30.0f));
+		spotLights[i].ambient = glm::vec3(0.2f, 0.2f, 0.2f);
+		spotLights[i].diffuse = glm::vec3(0.5f, 0.5f, 0.5f);
+		spotLights[i].specular = glm::vec3(1.0f, 1.0f, 1.0f);
+		spotLights[i].constant = 1.0f;
+		spotLights[i].linear = 0.09f;
+		spotLights[i].quadratic = 0.032f;
+		spotLights[i].radius = LightRadius(spotLights[i]);
+	}
+	//light poles
+	for (int i = 0; i < NUM_LIGHT_POLES; i++)
+	{
+		SpotLight &light = spotLights[i + 2];
+		light.position = lightPoleLampPositions[i];
+		light.direction = glm::vec3(0.0f, -10.0f, 0.0f);
+		light.cutOff = glm::cos(glm::radians(45.0f));
+		light.outerCutOff = glm::cos(glm::radians(90.0f));
+		light.ambient = glm::vec3(0.2f, 0.2f, 0.2f);
+		light.diffuse = glm::vec3(0.5f, 0.5f, 0.5f);
+		light.specular = glm::vec3(1.0f, 1.0f, 1.0f);
+		light.constant = 1.0f;
+		light.linear = 0.045f;
+		light.quadratic = 0.0075f;
+		light.radius = LightRadius(light);
+	}
+
+	FrameData frameData = {};
+	frameData.fogColor = fogColor;
+	frameData.fogDensity = fogDensity;
+
+	// SetInstances above left vertex array 0 bound; the instance attributes belong to the lamp cube's
+	GLState::BindVertexArray(lightVAO);
+	GLBuffer lampInstanceVBO = GLBuffer::Create();
+	glBindBuffer(GL_ARRAY_BUFFER, lampInstanceVBO);
+	glBufferData(GL_ARRAY_BUFFER, NUM_LIGHT_POLES * sizeof(glm::mat4), &lampCubeModelMatrices[0], GL_STATIC_DRAW);
+	// per-instance model matrix, one attribute per column
+	for (unsigned int i = 0; i < 4; i++)
+	{
+		glEnableVertexAttribArray(5 + i);
+		glVertexAttribPointer(5 + i, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)(i * sizeof(glm::vec4)));
+		glVertexAttribDivisor(5 + i, 1);
+	}
+	GLState::BindVertexArray(0);
+
+	Hud hud;
+	showHud = launch.hud;
+
+	// timings
+	// -------
+	// without a recording to follow, headless runs would otherwise depend on how fast they render
+	float timestep = launch.timestep;
+	if (launch.headless && !replaying && timestep <= 0.0f)
+		timestep = 1.0f / 60.0f;
+	unsigned int frameLimit = launch.frames > 0 ? launch.frames : replaying ? UINT_MAX : 300;
+
+	std::ofstream timings;
+	if (!launch.timingsPath.empty())
+	{
+		timings.open(launch.timingsPath.c_str());
+		timings << "frame,cpu_ms,simulated_ms" << std::endl;
+	}
+
+	GpuProfiler gpuProfiler;
+	std::ofstream gpuTimings;
+	if (launch.gpuProfile && gpuProfiler.SetEnabled(true) && !launch.gpuTimingsPath.empty())
+	{
+		gpuTimings.open(launch.gpuTimingsPath.c_str());
+		gpuProfiler.SetCsv(&gpuTimings);
+	}
+	// while profiling, each model is flushed on its own so it gets a timer of its own; the queue
+	// then only sorts within a model
+	auto endModelPass = [&]()
+	{
+		if (gpuProfiler.Enabled())
+			renderQueue.Flush();
+		gpuProfiler.End();
+	};
+
 	// render loop
 	// -----------
-	while (!glfwWindowShouldClose(window))
+	unsigned int frameCount = 0;
+	double runStart = secondsSinceStart();
+	while (launch.headless ? frameCount < frameLimit : !glfwWindowShouldClose(window))
 	{
+		PROFILE_ZONE("frame");
 		glm::vec4 clearColor = enableFog ? fogColor : enableNight ? blackishColor : blueishColor;
 		//carCamera.SetYawPitch(-90.0f - carModel.rotation, -20);
 
 		// per-frame time logic
 		// --------------------
-		float currentFrame = (float)glfwGetTime();
-		deltaTime = currentFrame - lastFrame;
+		double frameStart = secondsSinceStart();
+		float currentFrame = (float)frameStart;
+		float frameTime = currentFrame - lastFrame;
 		lastFrame = currentFrame;
 
 		// input
 		// -----
-		processInput(window);
+		// live or played back; the simulation only ever sees the InputState
+		InputState input = {};
+		{
+			PROFILE_ZONE("input");
+			if (replaying)
+			{
+				if (!inputLog.Next(input))
+					break;
+			}
+			else
+			{
+				if (!launch.headless)
+					pollInput(window, input);
+				input.deltaTime = timestep > 0.0f ? timestep : frameTime;
+				if (!launch.recordPath.empty())
+					inputLog.Record(input);
+			}
+			if (input.buttons & INPUT_QUIT)
+				break;
+			processInput(input);
+		}
+
+		// only now: the input step may end the loop, and the counters of the last rendered frame
+		// have to survive that
+		GLState::ResetStats();
+		RenderStats::ResetFrame();
+		if (frameCount > 0)
+			hud.AddFrameTime(frameTime * 1000.0f);
+		gpuProfiler.BeginFrame();
 
 		// render
 		// ------
 		glClearColor(clearColor[0], clearColor[1], clearColor[2], clearColor[3]);
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-		//camera
-
-		// don't forget to enable shader before setting uniforms
-		lampShader.use();
-
-		lampShader.setBool("enableFog", enableFog);
-
-		ourShader.use();
-
-		ourShader.setBool("enableFog", enableFog);
-		ourShader.setBool("enableNight", enableNight);
-		ourShader.setBool("gouraud", gouraud);
-		
-		//spotlight + attenuation
-		//ourShader.setVec3("spotLight.position", camera->Position);
-		//ourShader.setVec3("spotLight.direction", camera->Front);
-		//ourShader.setFloat("spotLight.cutOff", glm::cos(glm::radians(12.5f)));
-		//ourShader.setFloat("spotLight.outerCutOff", glm::cos(glm::radians(20.0f)));
-		//ourShader.setVec3("spotLight.ambient", 0.2f, 0.2f, 0.2f);
-		//ourShader.setVec3("spotLight.diffuse", 0.5f, 0.5f, 0.5f);
-		//ourShader.setVec3("spotLight.specular", 1.0f, 1.0f, 1.0f);
-		//ourShader.setFloat("spotLight.constant", 1.0f);
-		//ourShader.setFloat("spotLight.linear", 0.09f);
-		//ourShader.setFloat("spotLight.quadratic", 0.032f);
-		
-		//directional light
-		ourShader.setVec3("dirLight.direction", -0.2f, -1.0f, -0.3f);
-		ourShader.setVec3("dirLight.ambient", 0.1f, 0.1f, 0.1f);
-		ourShader.setVec3("dirLight.diffuse", 0.5f, 0.5f, 0.5f);
-		ourShader.setVec3("dirLight.specular", 1.0f, 1.0f, 1.0f);
-
 		// render the loaded model
 		glm::mat4 carModelMatrix = glm::mat4(1.0f);
 		carModelMatrix = glm::translate(carModelMatrix, carModel.position); // translate it down so it's at the center of the scene
@@ -288,10 +535,6 @@ int main()
 		//model = glm::scale(model, glm::vec3(0.02f, 0.02f, 0.02f));	// it's a bit too big for our scene, so scale it down
 		glm::mat4 fixedCarModelMatrix = glm::scale(carModelMatrix, glm::vec3(0.007f, 0.007f, 0.007f));	// it's a bit too big for our scene, so scale it down
 		fixedCarModelMatrix = glm::rotate(fixedCarModelMatrix, glm::radians(-90.0f), glm::vec3(1.0f, 0.0f, 0.0f));	// rotation
-		ourShader.setMat4("model", fixedCarModelMatrix);
-
-		glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(fixedCarModelMatrix)));
-		ourShader.setMat3("normalMatrix", fixedCarModelMatrix);
 
 		// camera
 		//carCamera.SetCarPosition(carModel.position, carModel.rotation);
@@ -300,139 +543,103 @@ int main()
 		AbstractCamera* camera = GetCamera();
 
 		// view/projection transformations
-		glm::mat4 projection = glm::perspective(glm::radians(camera->Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
+		glm::mat4 projection = glm::perspective(glm::radians(camera->Zoom), (float)screenWidth / (float)screenHeight, 0.1f, 100.0f);
 		glm::mat4 view = camera->GetViewMatrix();
-		ourShader.setMat4("projection", projection);
-		ourShader.setMat4("view", view);
-
-		ourShader.setVec3("viewPos", camera->Position);
-		lampShader.use();
-		lampShader.setVec3("viewPos", camera->Position);
-		ourShader.use();
-
-		for (int i = 0; i < NUM_LIGHT_POLES; i++)
-		{
-			ourShader.use();
-			glm::mat4 lightPoleModelMatrix = glm::mat4(1.0f);
-			lightPoleModelMatrix = glm::translate(lightPoleModelMatrix, lightPolePositions[i]); // translate it down so it's at the center of the scene
-			lightPoleModelMatrix = glm::rotate(lightPoleModelMatrix, glm::radians(lightPoleRotations[i]), glm::vec3(0.0f, 1.0f, 0.0f));	// rotation
-			lightPoleModelMatrix = glm::scale(lightPoleModelMatrix, glm::vec3(0.05f));	// it's a bit too big for our scene, so scale it down
-			ourShader.setMat4("model", lightPoleModelMatrix);
-
-			glm::mat3 normalLightPoleMatrix = glm::transpose(glm::inverse(glm::mat3(lightPoleModelMatrix)));
-			ourShader.setMat3("normalMatrix", normalLightPoleMatrix);
-			glm::vec3 lightPos = glm::vec3(lightPoleModelMatrix * glm::vec4(0.0f, 11.0f, -6.0f, 1.0f));
-			ourShader.setVec3(std::string("spotLights[").append(std::to_string(i + 2)) + "].position", lightPos);
-			ourShader.setVec3(std::string("spotLights[").append(std::to_string(i + 2)) + "].direction", glm::vec3(0.0f, -10.0f, 0.0f));
-			ourShader.setFloat(std::string("spotLights[").append(std::to_string(i + 2)) + "].cutOff", glm::cos(glm::radians(45.0f)));
-			ourShader.setFloat(std::string("spotLights[").append(std::to_string(i + 2)) + "].outerCutOff", glm::cos(glm::radians(90.0f)));
-			ourShader.setVec3(std::string("spotLights[").append(std::to_string(i + 2)) + "].ambient", 0.2f, 0.2f, 0.2f);
-			ourShader.setVec3(std::string("spotLights[").append(std::to_string(i + 2)) + "].diffuse", 0.5f, 0.5f, 0.5f);
-			ourShader.setVec3(std::string("spotLights[").append(std::to_string(i + 2)) + "].specular", 1.0f, 1.0f, 1.0f);
-			ourShader.setFloat(std::string("spotLights[").append(std::to_string(i + 2)) + "].constant", 1.0f);
-			ourShader.setFloat(std::string("spotLights[").append(std::to_string(i + 2)) + "].linear", 0.045f);
-			ourShader.setFloat(std::string("spotLights[").append(std::to_string(i + 2)) + "].quadratic", 0.0075f);
-
-			lampShader.use();
-			lampShader.setMat4("projection", projection);
-			lampShader.setMat4("view", view);
-			glm::mat4 cubemodel = glm::mat4(1.0f);
-			cubemodel = glm::translate(cubemodel, lightPos);
-			cubemodel = glm::scale(cubemodel, glm::vec3(0.1f)); // a smaller cube
-			lampShader.setMat4("model", cubemodel);
-
-			glBindVertexArray(lightVAO);
-			glDrawArrays(GL_TRIANGLES, 0, 36);
-		}
-		for (int i = 0; i < NUM_LIGHT_POLES; i++)
-		{
-			ourShader.use();
-			glm::mat4 lightPoleModelMatrix = glm::mat4(1.0f);
-			lightPoleModelMatrix = glm::translate(lightPoleModelMatrix, lightPolePositions[i]); // translate it down so it's at the center of the scene
-			lightPoleModelMatrix = glm::rotate(lightPoleModelMatrix, glm::radians(lightPoleRotations[i]), glm::vec3(0.0f, 1.0f, 0.0f));	// rotation
-			lightPoleModelMatrix = glm::scale(lightPoleModelMatrix, glm::vec3(0.05f));	// it's a bit too big for our scene, so scale it down
-			ourShader.setMat4("model", lightPoleModelMatrix);
-
-			glm::mat3 normalLightPoleMatrix = glm::transpose(glm::inverse(glm::mat3(lightPoleModelMatrix)));
-			ourShader.setMat3("normalMatrix", normalLightPoleMatrix);
-
-			lightPoleModel.Draw(ourShader);
-		}
-
-		ourShader.setMat4("model", fixedCarModelMatrix);
-		ourShader.setMat3("normalMatrix", fixedCarModelMatrix);
-
-		ourShader.use();
+		Frustum frustum = Frustum::FromMatrix(projection * view);
+		CullingStats cullingStats;
 
+		//headlights follow the car
 		//glm::vec3 spotlightPos = glm::vec3(carModelMatrix * glm::vec4(0.0f, 0.15f, -0.3f, 1.0f));
 		//glm::vec3 spotlightPos = glm::vec3(carModelMatrix * glm::vec4(-0.1f, 0.112f, -0.28f, 1.0f));
 		glm::vec3 spotlightDir = glm::vec3(carModelMatrix * glm::vec4(0.0f, reflectorHeight, -1.0f, 0.0f));//-glm::normalize(camera->Position - carModel.position);
 		glm::vec3 spotlightPos1 = glm::vec3(carModelMatrix * glm::vec4(0.1f, 0.112f, -0.285f, 1.0f));
+		glm::vec3 spotlightPos2 = glm::vec3(carModelMatrix * glm::vec4(-0.1f, 0.112f, -0.28f, 1.0f));
+		spotLights[0].position = spotlightPos1;
+		spotLights[0].direction = spotlightDir;
+		spotLights[1].position = spotlightPos2;
+		spotLights[1].direction = spotlightDir;
+		{
+			PROFILE_ZONE("light clustering");
+			clusteredLights.Update(spotLights, view, projection, 0.1f, 100.0f);
+			clusteredLights.Bind();
+		}
 
-		ourShader.setVec3("spotLights[0].position", spotlightPos1);
-		ourShader.setVec3("spotLights[0].direction", spotlightDir);
-		ourShader.setFloat("spotLights[0].cutOff", glm::cos(glm::radians(20.0f)));
-		ourShader.setFloat("spotLights[0].outerCutOff", glm::cos(glm::radians(30.0f)));
-		ourShader.setVec3("spotLights[0].ambient", 0.2f, 0.2f, 0.2f);
-		ourShader.setVec3("spotLights[0].diffuse", 0.5f, 0.5f, 0.5f);
-		ourShader.setVec3("spotLights[0].specular", 1.0f, 1.0f, 1.0f);
-		ourShader.setFloat("spotLights[0].constant", 1.0f);
-		ourShader.setFloat("spotLights[0].linear", 0.09f);
-		ourShader.setFloat("spotLights[0].quadratic", 0.032f);
+		frameData.view = view;
+		frameData.projection = projection;
+		frameData.viewPos = camera->Position;
+		frameData.sliceScale = clusteredLights.SliceScale();
+		frameData.sliceBias = clusteredLights.SliceBias();
+		frameDataBuffer.update(&frameData);
 
-		glm::vec3 spotlightPos2 = glm::vec3(carModelMatrix * glm::vec4(-0.1f, 0.112f, -0.28f, 1.0f));
+		unsigned int features = (gouraud ? GOURAUD_FEATURE : 0) | (enableFog ? FOG_FEATURE : 0) | (enableNight ? NIGHT_FEATURE : 0);
+		// each model adds what its geometry needs: instancing, the vertex format
+		auto modelShader = [&](const Model &model, bool instanced) -> Shader &
+		{
+			return modelShaders.Get(features | model.ShaderFeatures(instanced));
+		};
+
+		// the models are queued and drawn sorted by program, textures and depth
+		renderQueue.Begin(view, 0.1f, 100.0f);
+		glm::vec3 propAmbient(0.1f, 0.1f, 0.1f);
 
-		ourShader.setVec3("spotLights[1].position", spotlightPos2);
-		ourShader.setVec3("spotLights[1].direction", spotlightDir);
-		ourShader.setFloat("spotLights[1].cutOff", glm::cos(glm::radians(20.0f)));
-		ourShader.setFloat("spotLights[1].outerCutOff", glm::cos(glm::radians(30.0f)));
-		ourShader.setVec3("spotLights[1].ambient", 0.2f, 0.2f, 0.2f);
-		ourShader.setVec3("spotLights[1].diffuse", 0.5f, 0.5f, 0.5f);
-		ourShader.setVec3("spotLights[1].specular", 1.0f, 1.0f, 1.0f);
-		ourShader.setFloat("spotLights[1].constant", 1.0f);
-		ourShader.setFloat("spotLights[1].linear", 0.09f);
-		ourShader.setFloat("spotLights[1].quadratic", 0.032f);
+		// all poles in one draw per mesh
+		gpuProfiler.Begin("light poles");
+		lightPoleModel.SubmitInstanced(renderQueue, modelShader(lightPoleModel, true), propAmbient, frustum, cullingStats);
+		endModelPass();
 
-		carModel.Draw(ourShader);
+		gpuProfiler.Begin("car");
+		carModel.Submit(renderQueue, modelShader(carModel, false), fixedCarModelMatrix, glm::mat3(fixedCarModelMatrix), propAmbient, frustum, cullingStats);
+		endModelPass();
 
 		// road model
 		glm::mat4 streetModelMatrix = glm::mat4(1.0f);
 		streetModelMatrix = glm::translate(streetModelMatrix, glm::vec3(0.0f, -1.75f, 0.0f)); // translate it down so it's at the center of the scene
 		streetModelMatrix = glm::scale(streetModelMatrix, glm::vec3(0.02f, 0.02f, 0.02f));	// it's a bit too big for our scene, so scale it down
 		streetModelMatrix = glm::rotate(streetModelMatrix, glm::radians(-90.0f), glm::vec3(1.0f, 0.0f, 0.0f));	// rotation
-		ourShader.setMat4("model", streetModelMatrix);
 
 		glm::mat3 normalStreetMatrix = glm::transpose(glm::inverse(glm::mat3(streetModelMatrix)));
-		ourShader.setMat3("normalMatrix", normalStreetMatrix);
-
-		ourShader.setVec3("dirLight.ambient", 0.5f, 0.5f, 0.5f);
-		ourShader.setVec3("dirLight.diffuse", 0.5f, 0.5f, 0.5f);
-		ourShader.setVec3("dirLight.specular", 1.0f, 1.0f, 1.0f);
-
-		streetModel.Draw(ourShader);
+		gpuProfiler.Begin("track");
+		streetModel.Submit(renderQueue, modelShader(streetModel, false), streetModelMatrix, normalStreetMatrix, glm::vec3(0.5f, 0.5f, 0.5f), frustum, cullingStats);
+		endModelPass();
 
 		glm::mat4 otherModelMatrix = glm::mat4(1.0f);
 		otherModelMatrix = glm::translate(otherModelMatrix, glm::vec3(0.0f, -1.75f, 0.0f)); // translate it down so it's at the center of the scene
 		//otherModelMatrix = glm::scale(otherModelMatrix, glm::vec3(0.1f));
 		//otherModelMatrix = glm::scale(otherModelMatrix, glm::vec3(0.02f, 0.02f, 0.02f));	// it's a bit too big for our scene, so scale it down
-		ourShader.setMat4("model", otherModelMatrix);
 
 		glm::mat3 normalOtherMatrix = glm::transpose(glm::inverse(glm::mat3(otherModelMatrix)));
-		ourShader.setMat3("normalMatrix", normalOtherMatrix);
-		otherModel.Draw(ourShader);
+		// the cup keeps the street's brighter ambient, as before the queue
+		gpuProfiler.Begin("cup");
+		otherModel.Submit(renderQueue, modelShader(otherModel, false), otherModelMatrix, normalOtherMatrix, glm::vec3(0.5f, 0.5f, 0.5f), frustum, cullingStats);
+		endModelPass();
+
+		{
+			PROFILE_ZONE("flush");
+			renderQueue.Flush();
+		}
+
 
+		// lamp cubes: all poles in a single draw, then the headlights
+		// the lamps only depend on the fog
+		gpuProfiler.Begin("lamps");
+		Shader &poleLampShader = lampShaders.Get((features & FOG_FEATURE) | INSTANCED_FEATURE);
+		poleLampShader.use();
+		GLState::BindVertexArray(lightVAO);
+		glDrawArraysInstanced(GL_TRIANGLES, 0, 36, NUM_LIGHT_POLES);
+		RenderStats::CountDraw(36, NUM_LIGHT_POLES);
 
+		Shader &lampShader = lampShaders.Get(features & FOG_FEATURE);
 		lampShader.use();
-		lampShader.setMat4("projection", projection);
-		lampShader.setMat4("view", view);
+
 		glm::mat4 model = glm::mat4(1.0f);
 		model = glm::translate(model, spotlightPos1);
 		model = glm::rotate(model, glm::radians(carModel.rotation), glm::vec3(0.0f, 1.0f, 0.0f));
 		model = glm::scale(model, glm::vec3(0.02f)); // a smaller cube
 		lampShader.setMat4("model", model);
 
-		glBindVertexArray(lightVAO);
+		GLState::BindVertexArray(lightVAO);
 		glDrawArrays(GL_TRIANGLES, 0, 36);
+		RenderStats::CountDraw(36);
 
 		model = glm::mat4(1.0f);
 		model = glm::translate(model, spotlightPos2);
@@ -440,29 +647,141 @@ int main()
 		model = glm::scale(model, glm::vec3(0.02f)); // a smaller cube
 		lampShader.setMat4("model", model);
 
-		glBindVertexArray(lightVAO);
+		GLState::BindVertexArray(lightVAO);
 		glDrawArrays(GL_TRIANGLES, 0, 36);
+		RenderStats::CountDraw(36);
+		gpuProfiler.End();
+		gpuProfiler.EndFrame();
 
-		// glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
-		// -------------------------------------------------------------------------------
-		glfwSwapBuffers(window);
-		glfwPollEvents();
+		// culling counters in the title bar, once per second
+		if (!launch.headless && currentFrame - lastStatsUpdate >= 1.0f)
+		{
+			std::string title = "Graphics 3D - meshes drawn: " + std::to_string(cullingStats.drawn) + ", culled: " + std::to_string(cullingStats.culled)
+				+ " - programs: " + std::to_string(renderQueue.Stats().programSwitches) + ", material binds: " + std::to_string(renderQueue.Stats().materialBinds)
+				+ " - GL calls: " + std::to_string(GLState::Stats().issued) + ", filtered: " + std::to_string(GLState::Stats().filtered)
+				+ " - light assignments: " + std::to_string(clusteredLights.IndexCount()) + ", max per cluster: " + std::to_string(clusteredLights.MaxClusterLights());
+			glfwSetWindowTitle(window, title.c_str());
+			lastStatsUpdate = currentFrame;
+		}
+
+		// the overlay shows this frame's counters and the frame times so far
+		if (showHud)
+		{
+			PROFILE_ZONE("hud");
+			hud.Draw(RenderStats::Frame(), screenWidth, screenHeight);
+		}
+
+		frameCount++;
+		if (!launch.headless)
+		{
+			// glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
+			// -------------------------------------------------------------------------------
+			PROFILE_ZONE("swap");
+			glfwSwapBuffers(window);
+			glfwPollEvents();
+		}
+
+		if (timings.is_open())
+			timings << frameCount << "," << (secondsSinceStart() - frameStart) * 1000.0 << "," << input.deltaTime * 1000.0f << "\n";
+	}
+
+	if (!launch.recordPath.empty())
+	{
+		if (inputLog.Save(launch.recordPath))
+			std::cout << "INPUT_LOG::RECORDED " << inputLog.FrameCount() << " frames to " << launch.recordPath << std::endl;
+		else
+			std::cout << "ERROR::INPUT_LOG::FAILED_TO_WRITE " << launch.recordPath << std::endl;
+	}
+
+	if (launch.headless)
+	{
+		// the GPU may still be behind; wait for it before stopping the clock
+		glFinish();
+		double seconds = secondsSinceStart() - runStart;
+		std::cout << "HEADLESS::FRAMES " << frameCount << " at " << screenWidth << "x" << screenHeight << " in " << seconds << " s, "
+			<< (frameCount > 0 ? seconds * 1000.0 / frameCount : 0.0) << " ms per frame" << std::endl;
+		const RenderCounters &counters = RenderStats::Frame();
+		std::cout << "HEADLESS::LAST_FRAME " << counters.drawCalls << " draws, " << counters.triangles << " triangles, "
+			<< counters.programSwitches << " program switches, " << counters.textureBinds << " texture binds, "
+			<< counters.uniformUploads << " uniform uploads, " << counters.bufferBytes << " bytes uploaded" << std::endl;
+		if (!launch.capturePath.empty())
+			writeCapture(launch.capturePath, *renderTarget);
+	}
+
+	if (gpuProfiler.Enabled())
+	{
+		gpuProfiler.Finish();
+		std::vector<GpuPassStats> passes = gpuProfiler.Stats();
+		for (size_t i = 0; i < passes.size(); i++)
+		{
+			std::cout << "GPU::" << passes[i].name << " min " << passes[i].minMs << " ms, avg " << passes[i].avgMs
+				<< " ms, p99 " << passes[i].p99Ms << " ms over " << passes[i].samples << " frames" << std::endl;
+		}
+		if (gpuProfiler.DroppedFrames() > 0)
+			std::cout << "GPU::DROPPED " << gpuProfiler.DroppedFrames() << " frames still in flight when their queries were reused" << std::endl;
+	}
+
+	if (!launch.tracePath.empty())
+	{
+		if (CpuProfiler::WriteChromeTrace(launch.tracePath))
+			std::cout << "PROFILER::TRACE " << CpuProfiler::EventCount() << " zones to " << launch.tracePath << std::endl;
+		else
+			std::cout << "ERROR::PROFILER::FAILED_TO_WRITE " << launch.tracePath << std::endl;
 	}
 
 	// glfw: terminate, clearing all previously allocated GLFW resources.
 	// ------------------------------------------------------------------
-	glfwTerminate();
+	// the car outlives main, so release its meshes and textures now; terminator does the rest
+	carModel = Model();
 	return 0;
 }
 
-// process all input: query GLFW whether relevant keys are pressed/released this frame and react accordingly
+// gather this frame's input: query GLFW whether relevant keys are pressed/released and take the mouse
+// movement the callbacks collected since the last frame
 // ---------------------------------------------------------------------------------------------------------
-void processInput(GLFWwindow *window)
+void pollInput(GLFWwindow *window, InputState &input)
+{
+	const int keys[] = {
+		GLFW_KEY_UP, GLFW_KEY_DOWN, GLFW_KEY_LEFT, GLFW_KEY_RIGHT,
+		GLFW_KEY_W, GLFW_KEY_S, GLFW_KEY_A, GLFW_KEY_D,
+		GLFW_KEY_C, GLFW_KEY_F, GLFW_KEY_N, GLFW_KEY_G,
+		GLFW_KEY_Y, GLFW_KEY_H, GLFW_KEY_ESCAPE, GLFW_KEY_F1
+	}; // in InputButton order
+	input.buttons = 0;
+	for (unsigned int i = 0; i < sizeof(keys) / sizeof(keys[0]); i++)
+	{
+		if (glfwGetKey(window, keys[i]) == GLFW_PRESS)
+			input.buttons |= 1u << i;
+	}
+
+	input.mouseX = mouseDeltaX;
+	input.mouseY = mouseDeltaY;
+	input.scroll = scrollDelta;
+	mouseDeltaX = mouseDeltaY = scrollDelta = 0.0f;
+}
+
+// process all input: react to the keys held this frame, advancing the car and camera by input.deltaTime
+// ---------------------------------------------------------------------------------------------------------
+void processInput(const InputState &input)
 {
-	if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
-		glfwSetWindowShouldClose(window, true);
 	const float MovementSpeed = 2.5f;
 	const float RotateSpeed = 50.0f;
+	float deltaTime = input.deltaTime;
+
+	// mouse first: it moved while the previous frame was shown, i.e. with the camera of that frame
+	if (cameraId == 0 && (input.mouseX != 0.0f || input.mouseY != 0.0f))
+		fpsCamera.ProcessMouseMovement(input.mouseX, input.mouseY);
+	if (input.scroll != 0.0f)
+	{
+		if (cameraId == 0)
+		{
+			fpsCamera.ProcessMouseScroll(input.scroll);
+		}
+		else if (cameraId == 1)
+		{
+			carCamera.ProcessMouseScroll(input.scroll);
+		}
+	}
 
 	glm::mat4 transform1 = glm::mat4(1.0f);
 	transform1 = glm::rotate(transform1, glm::radians(carModel.rotation), glm::vec3(0.0f, 1.0f, 0.0f));
@@ -474,84 +793,52 @@ void processInput(GLFWwindow *window)
 	float velocity = MovementSpeed * deltaTime;
 	float rotateVelocity = RotateSpeed * deltaTime;
 
-	if (glfwGetKey(window, GLFW_KEY_UP) == GLFW_PRESS)
+	if (input.buttons & INPUT_CAR_FORWARD)
 	{
 		carCamera.distance = 1.0f;
 		carModel.position += Front * velocity;
 	}
-	if (glfwGetKey(window, GLFW_KEY_DOWN) == GLFW_PRESS)
+	if (input.buttons & INPUT_CAR_BACKWARD)
 	{
 		carCamera.distance = -1.0f;
 		carModel.position -= Front * velocity;
 	}
-	if (glfwGetKey(window, GLFW_KEY_LEFT) == GLFW_PRESS)
+	if (input.buttons & INPUT_CAR_LEFT)
 		carModel.rotation += rotateVelocity;
-	if (glfwGetKey(window, GLFW_KEY_RIGHT) == GLFW_PRESS)
+	if (input.buttons & INPUT_CAR_RIGHT)
 		carModel.rotation -= rotateVelocity;
 
 	if (cameraId == 0)
 	{
-		if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
+		if (input.buttons & INPUT_CAMERA_FORWARD)
 			fpsCamera.ProcessKeyboard(FORWARD, deltaTime);
-		if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
+		if (input.buttons & INPUT_CAMERA_BACKWARD)
 			fpsCamera.ProcessKeyboard(BACKWARD, deltaTime);
-		if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
+		if (input.buttons & INPUT_CAMERA_LEFT)
 			fpsCamera.ProcessKeyboard(LEFT, deltaTime);
-		if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
+		if (input.buttons & INPUT_CAMERA_RIGHT)
 			fpsCamera.ProcessKeyboard(RIGHT, deltaTime);
 	}
 
-	static int cKeyState = GLFW_RELEASE;
+	// the toggles react to a key going down, not to it being held
+	static uint32_t previousButtons = 0;
+	uint32_t pressed = input.buttons & ~previousButtons;
+	previousButtons = input.buttons;
 
-	if (glfwGetKey(window, GLFW_KEY_C) == GLFW_PRESS && cKeyState == GLFW_RELEASE)
-	{
-		cKeyState = GLFW_PRESS;
+	if (pressed & INPUT_NEXT_CAMERA)
 		cameraId = (cameraId + 1) % NUM_CAMERAS;
-	}
-	if (glfwGetKey(window, GLFW_KEY_C) == GLFW_RELEASE)
-	{
-		cKeyState = GLFW_RELEASE;
-	}
-	
-	static int fKeyState = GLFW_RELEASE;
-
-	if (glfwGetKey(window, GLFW_KEY_F) == GLFW_PRESS && fKeyState == GLFW_RELEASE)
-	{
-		fKeyState = GLFW_PRESS;
+	if (pressed & INPUT_TOGGLE_FOG)
 		enableFog = !enableFog;
-	}
-	if (glfwGetKey(window, GLFW_KEY_F) == GLFW_RELEASE)
-	{
-		fKeyState = GLFW_RELEASE;
-	}
-
-	static int nKeyState = GLFW_RELEASE;
-
-	if (glfwGetKey(window, GLFW_KEY_N) == GLFW_PRESS && nKeyState == GLFW_RELEASE)
-	{
-		nKeyState = GLFW_PRESS;
+	if (pressed & INPUT_TOGGLE_NIGHT)
 		enableNight = !enableNight;
-	}
-	if (glfwGetKey(window, GLFW_KEY_N) == GLFW_RELEASE)
-	{
-		nKeyState = GLFW_RELEASE;
-	}
-
-	static int gKeyState = GLFW_RELEASE;
-
-	if (glfwGetKey(window, GLFW_KEY_G) == GLFW_PRESS && gKeyState == GLFW_RELEASE)
-	{
-		gKeyState = GLFW_PRESS;
+	if (pressed & INPUT_TOGGLE_GOURAUD)
 		gouraud = !gouraud;
-	}
-	if (glfwGetKey(window, GLFW_KEY_G) == GLFW_RELEASE)
-	{
-		gKeyState = GLFW_RELEASE;
-	}
+	if (pressed & INPUT_TOGGLE_HUD)
+		showHud = !showHud;
 
-	if (glfwGetKey(window, GLFW_KEY_Y) == GLFW_PRESS)
+	if (input.buttons & INPUT_REFLECTOR_UP)
 		reflectorHeight = min(max(reflectorHeight + 0.01f, -0.3f), 0.1f);
-	if (glfwGetKey(window, GLFW_KEY_H) == GLFW_PRESS)
+	if (input.buttons & INPUT_REFLECTOR_DOWN)
 		reflectorHeight = min(max(reflectorHeight - 0.01f, -0.3f), 0.1f);
 }
 
@@ -559,6 +846,12 @@ void processInput(GLFWwindow *window)
 // ---------------------------------------------------------------------------------------------
 void framebuffer_size_callback(GLFWwindow* window, int width, int height)
 {
+	// a minimized window reports 0x0, which would make the aspect ratio meaningless
+	if (width > 0 && height > 0)
+	{
+		screenWidth = width;
+		screenHeight = height;
+	}
 	// make sure the viewport matches the new window dimensions; note that width and 
 	// height will be significantly larger than specified on retina displays.
 	glViewport(0, 0, width, height);
@@ -583,21 +876,17 @@ void mouse_callback(GLFWwindow* window, double xpos, double ypos)
 	lastX = (float)xpos;
 	lastY = (float)ypos;
 
-	fpsCamera.ProcessMouseMovement(xoffset, yoffset);
+	// applied by processInput, so it can be recorded with the rest of the frame's input
+	mouseDeltaX += xoffset;
+	mouseDeltaY += yoffset;
 }
 
 // glfw: whenever the mouse scroll wheel scrolls, this callback is called
 // ----------------------------------------------------------------------
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset)
 {
-	if (cameraId == 0)
-	{
-		fpsCamera.ProcessMouseScroll((float)yoffset);
-	}
-	else if (cameraId == 1)
-	{
-		carCamera.ProcessMouseScroll((float)yoffset);
-	}
+	// applied by processInput as well
+	scrollDelta += (float)yoffset;
 }
 
 AbstractCamera* GetCamera()
@@ -607,4 +896,76 @@ AbstractCamera* GetCamera()
 		return cameras[cameraId];
 	}
 	return nullptr;
-}
\ No newline at end of file
+}
+// prints where a model's geometry lives, in KB
+void printMemoryReport(const char *name, const Model &model)
+{
+	ModelMemory memory = model.Memory();
+	std::cout << "MODEL::MEMORY::" << name << " meshes: " << memory.meshes
+		<< ", CPU: " << memory.cpuBytes / 1024 << " KB, GPU: " << memory.gpuBytes / 1024 << " KB" << std::endl;
+}
+
+bool parseArguments(int argc, char **argv, LaunchOptions &options)
+{
+	for (int i = 1; i < argc; i++)
+	{
+		std::string argument = argv[i];
+		const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+		if (argument == "--headless")
+			options.headless = true;
+		else if (argument == "--size" && value && sscanf(value, "%ux%u", &screenWidth, &screenHeight) == 2 && screenWidth > 0 && screenHeight > 0)
+			i++;
+		else if (argument == "--frames" && value && sscanf(value, "%u", &options.frames) == 1)
+			i++;
+		else if (argument == "--gpu-profile")
+			options.gpuProfile = true;
+		else if (argument == "--hud")
+			options.hud = true;
+		else if (argument == "--timestep" && value && sscanf(value, "%f", &options.timestep) == 1)
+			i++;
+		else if (argument == "--gpu-timings" && value)
+		{
+			options.gpuProfile = true;
+			options.gpuTimingsPath = value;
+			i++;
+		}
+		else if ((argument == "--capture" || argument == "--record" || argument == "--replay" || argument == "--timings" || argument == "--trace") && value)
+		{
+			std::string &path = argument == "--capture" ? options.capturePath : argument == "--record" ? options.recordPath
+				: argument == "--replay" ? options.replayPath : argument == "--trace" ? options.tracePath : options.timingsPath;
+			path = value;
+			i++;
+		}
+		else
+		{
+			std::cout << "usage: " << argv[0] << " [--headless] [--size WIDTHxHEIGHT] [--frames N] [--capture FILE.ppm]"
+				<< " [--record FILE | --replay FILE] [--timestep SECONDS] [--timings FILE.csv]"
+				<< " [--gpu-profile] [--gpu-timings FILE.csv] [--trace FILE.json] [--hud]" << std::endl;
+			return false;
+		}
+	}
+	return true;
+}
+
+// saves the target's color buffer as a binary PPM; the target must be bound
+void writeCapture(const std::string &path, const RenderTarget &target)
+{
+	std::vector<unsigned char> pixels;
+	target.ReadPixels(pixels);
+	std::ofstream out(path.c_str(), std::ios::binary);
+	out << "P6\n" << target.width << " " << target.height << "\n255\n";
+	// GL rows start at the bottom, PPM rows at the top
+	for (unsigned int y = target.height; y-- > 0;)
+	{
+		for (unsigned int x = 0; x < target.width; x++)
+			out.write((const char*)&pixels[((size_t)y * target.width + x) * 4], 3);
+	}
+	if (!out)
+		std::cout << "ERROR::CAPTURE::FAILED_TO_WRITE " << path << std::endl;
+}
+
+double secondsSinceStart()
+{
+	static const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}